@@ -0,0 +1,210 @@
+#include "bookmark_cache.h"
+#include "bookmarks.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <QVector>
+
+#include <cstring>
+
+const quint32 CACHE_MAGIC = 0x43424331;
+const quint32 CACHE_VERSION = 1;
+const int HASH_SIZE = 16;
+
+// stored in native byte order, a cache from another machine fails the magic check and is rebuilt
+struct CacheHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 journal_generation;
+    quint32 node_count;
+    qint64 journal_offset;
+    qint64 xbel_size;
+    quint64 string_length;
+    char xbel_hash[HASH_SIZE];
+};
+
+struct CachedNode
+{
+    quint32 type;
+    quint32 child_count;
+    quint32 title_offset;
+    quint32 title_length;
+    quint32 address_offset;
+    quint32 address_length;
+    quint32 desc_offset;
+    quint32 desc_length;
+};
+
+static_assert(sizeof(CacheHeader) % alignof(CachedNode) == 0, "nodes follow the header without padding");
+
+class CacheWriter
+{
+    QVector<CachedNode> m_nodes;
+    QString m_strings;
+    QHash<QString, quint32> m_offsets;
+
+    void add_string(const QString &string, quint32 *offset, quint32 *length)
+    {
+        auto it = m_offsets.constFind(string);
+        if (it == m_offsets.constEnd()) {
+            it = m_offsets.insert(string, m_strings.length());
+            m_strings.append(string);
+        }
+        *offset = it.value();
+        *length = string.length();
+    }
+public:
+    void add_node(const BookmarkTreeNode *node)
+    {
+        CachedNode cached;
+        cached.type = node->type;
+        cached.child_count = node->children.count();
+        add_string(node->title, &cached.title_offset, &cached.title_length);
+        add_string(node->address, &cached.address_offset, &cached.address_length);
+        add_string(node->desc, &cached.desc_offset, &cached.desc_length);
+        m_nodes.append(cached);
+
+        for (const BookmarkTreeNode *child : node->children) {
+            add_node(child);
+        }
+    }
+
+    QByteArray data(const BookmarkCacheInfo &info) const
+    {
+        CacheHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = CACHE_MAGIC;
+        header.version = CACHE_VERSION;
+        header.journal_generation = info.journal_generation;
+        header.journal_offset = info.journal_offset;
+        header.node_count = m_nodes.count();
+        header.string_length = m_strings.length();
+
+        QByteArray data;
+        data.reserve(sizeof(header) + m_nodes.count() * sizeof(CachedNode) + m_strings.length() * sizeof(QChar));
+        data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        data.append(reinterpret_cast<const char *>(m_nodes.constData()), m_nodes.count() * sizeof(CachedNode));
+        data.append(reinterpret_cast<const char *>(m_strings.constData()), m_strings.length() * sizeof(QChar));
+        return data;
+    }
+};
+
+static QByteArray xbel_hash(const uchar *data, qint64 size)
+{
+    return QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char *>(data), size), QCryptographicHash::Md5);
+}
+
+QByteArray BookmarkCache::serialize(const BookmarkTreeNode *root, const BookmarkCacheInfo &info)
+{
+    CacheWriter writer;
+    writer.add_node(root);
+    return writer.data(info);
+}
+
+bool BookmarkCache::write(const QString &path, QByteArray cache, const QByteArray &xbel)
+{
+    if (cache.size() < int(sizeof(CacheHeader)))
+        return false;
+
+    CacheHeader *header = reinterpret_cast<CacheHeader *>(cache.data());
+    header->xbel_size = xbel.size();
+    std::memcpy(header->xbel_hash, xbel_hash(reinterpret_cast<const uchar *>(xbel.constData()), xbel.size()).constData(), HASH_SIZE);
+
+    QSaveFile file(path);
+    if (!file.open(QFile::WriteOnly) || file.write(cache) != cache.size() || !file.commit()) {
+        qDebug() << "Error writing bookmarks cache" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+BookmarkTreeNode *BookmarkCache::read(const QString &path, const QString &xbel_path, BookmarkCacheInfo *info)
+{
+    QFile file(path);
+    QFile xbel(xbel_path);
+    if (!file.open(QFile::ReadOnly) || !xbel.open(QFile::ReadOnly))
+        return nullptr;
+
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(CacheHeader)))
+        return nullptr;
+
+    const uchar *data = file.map(0, size);
+    if (!data)
+        return nullptr;
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.xbel_size != xbel.size())
+        return nullptr;
+
+    const qint64 strings_start = sizeof(header) + qint64(header.node_count) * sizeof(CachedNode);
+    if (header.node_count == 0 || size != strings_start + qint64(header.string_length) * qint64(sizeof(QChar)))
+        return nullptr;
+
+    // the snapshot may have been replaced or edited by hand since the cache was written
+    const uchar *xbel_data = header.xbel_size > 0 ? xbel.map(0, header.xbel_size) : nullptr;
+    if (header.xbel_size > 0 && !xbel_data)
+        return nullptr;
+    if (xbel_hash(xbel_data, header.xbel_size) != QByteArray::fromRawData(header.xbel_hash, HASH_SIZE))
+        return nullptr;
+
+    const CachedNode *nodes = reinterpret_cast<const CachedNode *>(data + sizeof(header));
+    const QChar *strings = reinterpret_cast<const QChar *>(data + strings_start);
+    auto string = [&header, strings] (quint32 offset, quint32 length, QString *out) {
+        if (quint64(offset) + length > header.string_length)
+            return false;
+        *out = QString(strings + offset, length);
+        return true;
+    };
+
+    struct Pending
+    {
+        BookmarkTreeNode *node;
+        quint32 remaining;
+    };
+
+    // nodes are stored depth first, each followed by its children
+    BookmarkTreeNode *root = nullptr;
+    QVector<Pending> stack;
+    for (quint32 i = 0; i < header.node_count; i++) {
+        const CachedNode &cached = nodes[i];
+        const bool is_root = i == 0;
+        if (is_root != (cached.type == BookmarkTreeNode::Root) || (!is_root && stack.isEmpty()) || cached.type > BookmarkTreeNode::Address) {
+            delete root;
+            return nullptr;
+        }
+
+        BookmarkTreeNode *parent = is_root ? nullptr : stack.last().node;
+        BookmarkTreeNode *node = new BookmarkTreeNode(BookmarkTreeNode::Type(cached.type), parent);
+        node->children.reserve(cached.child_count);
+        if (is_root)
+            root = node;
+
+        if (!string(cached.title_offset, cached.title_length, &node->title)
+                || !string(cached.address_offset, cached.address_length, &node->address)
+                || !string(cached.desc_offset, cached.desc_length, &node->desc)) {
+            delete root;
+            return nullptr;
+        }
+
+        // a parent is complete once its last child starts, that child's subtree follows
+        if (!is_root && --stack.last().remaining == 0)
+            stack.removeLast();
+        if (cached.child_count > 0)
+            stack.append(Pending { node, cached.child_count });
+    }
+
+    if (!stack.isEmpty()) {
+        delete root;
+        return nullptr;
+    }
+
+    info->journal_generation = header.journal_generation;
+    info->journal_offset = header.journal_offset;
+    return root;
+}
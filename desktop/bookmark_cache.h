@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+class BookmarkTreeNode;
+
+struct BookmarkCacheInfo
+{
+    quint32 journal_generation = 0;
+    qint64 journal_offset = 0;
+};
+
+class BookmarkCache
+{
+public:
+    static QByteArray serialize(const BookmarkTreeNode *root, const BookmarkCacheInfo &info);
+    static bool write(const QString &path, QByteArray cache, const QByteArray &xbel);
+    static BookmarkTreeNode *read(const QString &path, const QString &xbel_path, BookmarkCacheInfo *info);
+};
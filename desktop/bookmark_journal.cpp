@@ -0,0 +1,439 @@
+#include "bookmark_cache.h"
+#include "bookmark_journal.h"
+#include "bookmarks.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QPointer>
+#include <QSaveFile>
+#include <QThread>
+
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <io.h>
+#endif
+
+const quint32 JOURNAL_MAGIC = 0x43424a31;
+const qint64 HEADER_SIZE = 8;
+const qint64 FRAME_HEADER_SIZE = 6;
+const int COMPACTION_RECORDS = 256;
+const int COMPACTION_DELAY = 5 * 1000;
+const int IDLE_COMPACTION_DELAY = 60 * 1000;
+
+enum Operation : quint8
+{
+    Insert,
+    Move,
+    Remove,
+    Edit,
+};
+
+static void write_node(QDataStream &stream, const BookmarkTreeNode *node)
+{
+    stream << quint8(node->type) << node->title << node->address << node->desc << quint32(node->children.count());
+    for (const BookmarkTreeNode *child : node->children) {
+        write_node(stream, child);
+    }
+}
+
+static BookmarkTreeNode *read_node(QDataStream &stream, BookmarkTreeNode *parent = nullptr)
+{
+    quint8 type;
+    quint32 count;
+    BookmarkTreeNode *node = new BookmarkTreeNode(BookmarkTreeNode::Address, parent);
+    stream >> type >> node->title >> node->address >> node->desc >> count;
+    node->type = type == BookmarkTreeNode::Folder ? BookmarkTreeNode::Folder : BookmarkTreeNode::Address;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        read_node(stream, node);
+    }
+    return node;
+}
+
+static QByteArray journal_header(quint32 generation)
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << JOURNAL_MAGIC << generation;
+    return header;
+}
+
+static bool sync_file(QFile &file)
+{
+    if (!file.flush())
+        return false;
+#if defined(Q_OS_UNIX)
+    return ::fsync(file.handle()) == 0;
+#elif defined(Q_OS_WIN)
+    return ::_commit(file.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+QVector<int> BookmarkJournal::path(const BookmarkTreeNode *node)
+{
+    QVector<int> path;
+    while (node->parent) {
+        path.prepend(node->row);
+        node = node->parent;
+    }
+    return path;
+}
+
+BookmarkTreeNode *BookmarkJournal::node_at(const QVector<int> &path) const
+{
+    BookmarkTreeNode *node = m_root_node;
+    for (int row : path) {
+        if (row < 0 || row >= node->children.count())
+            return nullptr;
+        node = node->children.at(row);
+    }
+    return node;
+}
+
+void BookmarkJournal::append(const QByteArray &payload)
+{
+    QByteArray frame;
+    QDataStream stream(&frame, QIODevice::WriteOnly);
+    stream << quint32(payload.size()) << qChecksum(payload.constData(), payload.size());
+    frame.append(payload);
+
+    if (m_journal.write(frame) != frame.size() || !sync_file(m_journal))
+        qDebug() << "Error writing bookmarks journal" << m_journal.errorString();
+
+    m_record_count++;
+    if (m_record_count >= COMPACTION_RECORDS)
+        m_compaction_timer->start();
+
+    // a few edits are also folded into bookmarks.xbel once editing goes quiet
+    m_idle_timer->start();
+}
+
+qint64 BookmarkJournal::replay(const QByteArray &data, qint64 start)
+{
+    qint64 position = start;
+    while (position + FRAME_HEADER_SIZE <= data.size()) {
+        quint32 length;
+        quint16 checksum;
+        QDataStream header(QByteArray::fromRawData(data.constData() + position, FRAME_HEADER_SIZE));
+        header >> length >> checksum;
+
+        // a torn write at the tail is the expected result of a crash, anything after it is dropped
+        if (position + FRAME_HEADER_SIZE + length > data.size())
+            break;
+
+        const QByteArray payload = QByteArray::fromRawData(data.constData() + position + FRAME_HEADER_SIZE, length);
+        if (qChecksum(payload.constData(), payload.size()) != checksum)
+            break;
+
+        QDataStream stream(payload);
+        if (!apply(stream)) {
+            qDebug() << "Error replaying bookmarks journal at" << position;
+            break;
+        }
+
+        position += FRAME_HEADER_SIZE + length;
+        m_record_count++;
+    }
+    return position;
+}
+
+bool BookmarkJournal::apply(QDataStream &stream)
+{
+    quint8 operation;
+    QVector<int> path;
+    stream >> operation >> path;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    BookmarkTreeNode *node = node_at(path);
+    if (!node)
+        return false;
+
+    switch (operation) {
+    case Insert: {
+        qint32 row;
+        stream >> row;
+        if (row < 0 || row > node->children.count())
+            return false;
+
+        BookmarkTreeNode *child = read_node(stream);
+        if (stream.status() != QDataStream::Ok) {
+            delete child;
+            return false;
+        }
+        node->insert(child, row);
+        return true;
+    }
+    case Move: {
+        QVector<int> parent_path;
+        qint32 row;
+        stream >> parent_path >> row;
+        if (stream.status() != QDataStream::Ok || node == m_root_node)
+            return false;
+
+        // the destination was recorded after the move, which is the tree without the node
+        BookmarkTreeNode *parent = node->parent;
+        const int from = node->row;
+        parent->remove(node);
+
+        BookmarkTreeNode *destination = node_at(parent_path);
+        if (!destination || row < 0 || row > destination->children.count()) {
+            parent->insert(node, from);
+            return false;
+        }
+        destination->insert(node, row);
+        return true;
+    }
+    case Remove:
+        if (node == m_root_node)
+            return false;
+        delete node;
+        return true;
+    case Edit: {
+        quint8 column;
+        QString value;
+        stream >> column >> value;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+
+        switch (column) {
+        case 0: node->title = value; return true;
+        case 1: node->address = value; return true;
+        case 2: node->desc = value; return true;
+        }
+        return false;
+    }
+    }
+
+    return false;
+}
+
+bool BookmarkJournal::reset_journal(quint32 generation, const QByteArray &records)
+{
+    m_journal.close();
+
+    QSaveFile file(m_journal_path);
+    if (!file.open(QFile::WriteOnly) || file.write(journal_header(generation) + records) == -1 || !file.commit()) {
+        qDebug() << "Error resetting bookmarks journal" << file.errorString();
+        m_journal.open(QFile::WriteOnly | QFile::Append);
+        return false;
+    }
+
+    m_generation = generation;
+    if (!m_journal.open(QFile::WriteOnly | QFile::Append))
+        qDebug() << "Error opening bookmarks journal" << m_journal.errorString();
+    return true;
+}
+
+void BookmarkJournal::rebuild_cache(quint32 generation, qint64 offset)
+{
+    BookmarkCacheInfo info;
+    info.journal_generation = generation;
+    info.journal_offset = offset;
+    const QByteArray cache = BookmarkCache::serialize(m_root_node, info);
+
+    const QString path = m_cache_path;
+    const QString snapshot_path = m_snapshot_path;
+    QMetaObject::invokeMethod(m_writer, [path, snapshot_path, cache] {
+        QFile file(snapshot_path);
+        if (file.open(QFile::ReadOnly))
+            BookmarkCache::write(path, cache, file.readAll());
+    });
+}
+
+void BookmarkJournal::finish_compaction(bool ok, qint64 offset, int record_count)
+{
+    m_is_compacting = false;
+    if (!ok)
+        return;
+
+    // records appended while the snapshot was written carry over into the next generation
+    QByteArray records;
+    QFile file(m_journal_path);
+    if (file.open(QFile::ReadOnly) && file.seek(offset))
+        records = file.readAll();
+
+    if (reset_journal(m_generation + 1, records))
+        m_record_count -= record_count;
+}
+
+BookmarkJournal::BookmarkJournal(const QString &directory, QObject *parent)
+    : QObject(parent)
+{
+    const QDir dir(directory);
+    dir.mkpath(QStringLiteral("."));
+    m_snapshot_path = dir.absoluteFilePath(QStringLiteral("bookmarks.xbel"));
+    m_journal_path = dir.absoluteFilePath(QStringLiteral("bookmarks.journal"));
+    m_cache_path = dir.absoluteFilePath(QStringLiteral("bookmarks.cache"));
+    m_journal.setFileName(m_journal_path);
+
+    m_thread = new QThread(this);
+    m_thread->setObjectName(QStringLiteral("BookmarkJournal"));
+
+    m_writer = new QObject;
+    m_writer->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_writer, &QObject::deleteLater);
+    m_thread->start();
+
+    m_compaction_timer = new QTimer(this);
+    m_compaction_timer->setSingleShot(true);
+    m_compaction_timer->setInterval(COMPACTION_DELAY);
+    connect(m_compaction_timer, &QTimer::timeout, this, &BookmarkJournal::compact);
+
+    m_idle_timer = new QTimer(this);
+    m_idle_timer->setSingleShot(true);
+    m_idle_timer->setInterval(IDLE_COMPACTION_DELAY);
+    connect(m_idle_timer, &QTimer::timeout, this, &BookmarkJournal::compact);
+}
+
+BookmarkJournal::~BookmarkJournal()
+{
+    // leave an up to date bookmarks.xbel behind; the journal reset is redone on the next load
+    compact();
+    QMetaObject::invokeMethod(m_writer, [] {}, Qt::BlockingQueuedConnection);
+
+    // the journal is already durable, an unfinished compaction is simply redone next time
+    m_thread->quit();
+    m_thread->wait();
+}
+
+BookmarkTreeNode *BookmarkJournal::load()
+{
+    BookmarkCacheInfo info;
+    m_root_node = BookmarkCache::read(m_cache_path, m_snapshot_path, &info);
+    if (!m_root_node) {
+        XbelReader reader;
+        m_root_node = reader.read(m_snapshot_path);
+        if (reader.error() != QXmlStreamReader::NoError)
+            qDebug() << "Error loading bookmarks file" << reader.errorString();
+
+        info.journal_generation = reader.journal_generation();
+        info.journal_offset = reader.journal_offset();
+        if (QFile::exists(m_snapshot_path))
+            rebuild_cache(info.journal_generation, info.journal_offset);
+    }
+
+    // a snapshot of generation n covers journal generation n - 1 up to the recorded offset
+    const quint32 snapshot_generation = info.journal_generation;
+    m_generation = snapshot_generation;
+    qint64 end = -1;
+
+    QFile file(m_journal_path);
+    if (file.open(QFile::ReadOnly)) {
+        const QByteArray data = file.readAll();
+        quint32 magic;
+        quint32 generation;
+        QDataStream stream(data);
+        stream >> magic >> generation;
+
+        if (stream.status() == QDataStream::Ok && magic == JOURNAL_MAGIC) {
+            if (generation == snapshot_generation) {
+                end = replay(data, HEADER_SIZE);
+            } else if (generation + 1 == snapshot_generation && info.journal_offset >= HEADER_SIZE) {
+                m_generation = generation;
+                end = replay(data, info.journal_offset);
+            }
+        }
+        file.close();
+    }
+
+    if (end == -1) {
+        reset_journal(m_generation, QByteArray());
+    } else {
+        if (file.size() != end)
+            file.resize(end);
+        if (!m_journal.open(QFile::WriteOnly | QFile::Append))
+            qDebug() << "Error opening bookmarks journal" << m_journal.errorString();
+    }
+
+    if (m_record_count >= COMPACTION_RECORDS)
+        m_compaction_timer->start();
+    else if (m_record_count > 0)
+        m_idle_timer->start();
+
+    return m_root_node;
+}
+
+void BookmarkJournal::record_insert(BookmarkTreeNode *node)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    const QVector<int> node_path = path(node);
+    stream << quint8(Insert) << node_path.mid(0, node_path.count() - 1) << qint32(node_path.last());
+    write_node(stream, node);
+    append(payload);
+}
+
+void BookmarkJournal::record_move(const QVector<int> &from, BookmarkTreeNode *node)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    const QVector<int> node_path = path(node);
+    stream << quint8(Move) << from << node_path.mid(0, node_path.count() - 1) << qint32(node_path.last());
+    append(payload);
+}
+
+void BookmarkJournal::record_remove(const QVector<int> &path)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << quint8(Remove) << path;
+    append(payload);
+}
+
+void BookmarkJournal::record_edit(BookmarkTreeNode *node, int column, const QString &value)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << quint8(Edit) << path(node) << quint8(column) << value;
+    append(payload);
+}
+
+void BookmarkJournal::compact()
+{
+    if (m_is_compacting || m_record_count == 0)
+        return;
+
+    m_is_compacting = true;
+    m_compaction_timer->stop();
+    m_idle_timer->stop();
+
+    // serialize here where the tree lives, the slow part is writing and syncing the file
+    const qint64 offset = m_journal.size();
+    const int record_count = m_record_count;
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::WriteOnly);
+    XbelWriter writer;
+    writer.set_journal_position(m_generation + 1, offset);
+    writer.write(&buffer, m_root_node);
+
+    BookmarkCacheInfo info;
+    info.journal_generation = m_generation + 1;
+    info.journal_offset = offset;
+    const QByteArray cache = BookmarkCache::serialize(m_root_node, info);
+
+    const QString path = m_snapshot_path;
+    const QString cache_path = m_cache_path;
+    QPointer<BookmarkJournal> journal(this);
+    QMetaObject::invokeMethod(m_writer, [path, cache_path, data, cache, offset, record_count, journal] {
+        QSaveFile file(path);
+        const bool ok = file.open(QFile::WriteOnly) && file.write(data) == data.size() && file.commit();
+        if (ok)
+            BookmarkCache::write(cache_path, cache, data);
+        else
+            qDebug() << "Error writing bookmarks file" << file.errorString();
+
+        if (BookmarkJournal *object = journal.data()) {
+            QMetaObject::invokeMethod(object, [object, ok, offset, record_count] {
+                object->finish_compaction(ok, offset, record_count);
+            });
+        }
+    });
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QFile>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+class BookmarkTreeNode;
+class QDataStream;
+class QThread;
+
+class BookmarkJournal : public QObject
+{
+    QString m_snapshot_path;
+    QString m_journal_path;
+    QString m_cache_path;
+    QFile m_journal;
+    BookmarkTreeNode *m_root_node = nullptr;
+    quint32 m_generation = 0;
+    int m_record_count = 0;
+    bool m_is_compacting = false;
+
+    QThread *m_thread = nullptr;
+    QObject *m_writer = nullptr;
+    QTimer *m_compaction_timer = nullptr;
+    QTimer *m_idle_timer = nullptr;
+
+    void append(const QByteArray &payload);
+    qint64 replay(const QByteArray &data, qint64 start);
+    bool apply(QDataStream &stream);
+    bool reset_journal(quint32 generation, const QByteArray &records);
+    void rebuild_cache(quint32 generation, qint64 offset);
+    void finish_compaction(bool ok, qint64 offset, int record_count);
+    BookmarkTreeNode *node_at(const QVector<int> &path) const;
+public:
+    explicit BookmarkJournal(const QString &directory, QObject *parent = nullptr);
+    ~BookmarkJournal();
+
+    BookmarkTreeNode *load();
+    void record_insert(BookmarkTreeNode *node);
+    void record_move(const QVector<int> &from, BookmarkTreeNode *node);
+    void record_remove(const QVector<int> &path);
+    void record_edit(BookmarkTreeNode *node, int column, const QString &value);
+    void compact();
+
+    static QVector<int> path(const BookmarkTreeNode *node);
+};
@@ -1,20 +1,31 @@
+#include "bookmark_journal.h"
 #include "bookmarks.h"
 #include "browser.h"
 #include "browser_window.h"
+#include "link_checker.h"
 #include "tab.h"
 #include "webview.h"
 
 #include <QBuffer>
 #include <QDebug>
-#include <QDir>
 #include <QDataStream>
+#include <QDialog>
 #include <QFile>
+#include <QHBoxLayout>
+#include <QLabel>
 #include <QMenu>
 #include <QMimeData>
+#include <QPushButton>
+#include <QRegularExpression>
 #include <QStandardPaths>
+#include <QSharedPointer>
 #include <QStyleFactory>
+#include <QTreeWidget>
+#include <QUrl>
 #include <QVBoxLayout>
 
+#include <algorithm>
+
 BookmarkTreeNode::BookmarkTreeNode(BookmarkTreeNode::Type type, BookmarkTreeNode *parent)
     : parent(parent)
     , type(type)
@@ -28,6 +39,10 @@ BookmarkTreeNode::~BookmarkTreeNode()
     if (parent)
         parent->remove(this);
 
+    // detach first so the children do not renumber their siblings while being deleted
+    for (BookmarkTreeNode *child : qAsConst(children)) {
+        child->parent = nullptr;
+    }
     qDeleteAll(children);
 }
 
@@ -40,42 +55,95 @@ void BookmarkTreeNode::insert(BookmarkTreeNode *child, int index)
     if (index == -1)
         index = children.count();
     children.insert(index, child);
+
+    for (int i = index; i < children.count(); i++) {
+        children.at(i)->row = i;
+    }
 }
 
 void BookmarkTreeNode::remove(BookmarkTreeNode *child)
 {
+    if (child->parent != this)
+        return;
+
+    children.remove(child->row);
+    for (int i = child->row; i < children.count(); i++) {
+        children.at(i)->row = i;
+    }
+
     child->parent = nullptr;
-    children.removeAll(child);
+    child->row = 0;
+}
+
+static QString searchable_address(const QString &address)
+{
+    const int scheme_end = address.indexOf(QStringLiteral("://"));
+    return scheme_end == -1 ? address : address.mid(scheme_end + 3);
+}
+
+void BookmarkModel::index_entry(BookmarkTreeNode *node)
+{
+    if (node->type == BookmarkTreeNode::Address)
+        m_addresses.insert(canonical_address(node->address), node);
+
+    if (!m_has_tokens)
+        return;
+
+    const QStringList words = tokens(node->title + QLatin1Char(' ') + searchable_address(node->address) + QLatin1Char(' ') + node->desc);
+    for (const QString &word : words) {
+        m_tokens[word].insert(node);
+    }
 }
 
-void BookmarkModel::save()
+void BookmarkModel::unindex_entry(BookmarkTreeNode *node)
 {
-    QDir standardLocation(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
-    const QString path = standardLocation.absoluteFilePath(QStringLiteral("bookmarks.xbel"));
-    XbelWriter writer;
-    writer.write(path, m_root_node);
+    if (node->type == BookmarkTreeNode::Address)
+        m_addresses.remove(canonical_address(node->address), node);
+
+    if (!m_has_tokens)
+        return;
+
+    const QStringList words = tokens(node->title + QLatin1Char(' ') + searchable_address(node->address) + QLatin1Char(' ') + node->desc);
+    for (const QString &word : words) {
+        auto it = m_tokens.find(word);
+        if (it == m_tokens.end())
+            continue;
+
+        it->remove(node);
+        if (it->isEmpty())
+            m_tokens.erase(it);
+    }
+}
+
+void BookmarkModel::index_node(BookmarkTreeNode *node)
+{
+    index_entry(node);
+
+    for (BookmarkTreeNode *child : qAsConst(node->children)) {
+        index_node(child);
+    }
+}
+
+void BookmarkModel::unindex_node(BookmarkTreeNode *node)
+{
+    unindex_entry(node);
+
+    for (BookmarkTreeNode *child : qAsConst(node->children)) {
+        unindex_node(child);
+    }
 }
 
 BookmarkModel::BookmarkModel(QObject *parent)
     : QAbstractItemModel(parent)
 {
-    QDir standardLocation(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
-    const QString path = standardLocation.absoluteFilePath(QStringLiteral("bookmarks.xbel"));
-    if (QFile::exists(path)) {
-        XbelReader reader;
-        m_root_node = reader.read(path);
-        if (reader.error() != QXmlStreamReader::NoError) {
-            qDebug() << "Error loading bookmarks file" << reader.errorString();
-        }
-    } else {
-        m_root_node = new BookmarkTreeNode(BookmarkTreeNode::Root);
-    }
+    m_journal = new BookmarkJournal(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation), this);
+    m_root_node = m_journal->load();
+    index_node(m_root_node);
 }
 
 BookmarkModel::~BookmarkModel()
 {
-    if (m_is_dirty)
-        save();
+    delete m_journal;
     delete m_root_node;
 }
 
@@ -160,11 +228,7 @@ QModelIndex BookmarkModel::parent(const QModelIndex &child) const
     BookmarkTreeNode *child_node = tree_node(child);
     BookmarkTreeNode *parent_node = child_node->parent;
 
-    if (!parent_node || parent_node == m_root_node)
-        return QModelIndex();
-
-    int row = parent_node->parent->children.indexOf(parent_node);
-    return createIndex(row, 0, parent_node);
+    return node_index(parent_node);
 }
 
 Qt::ItemFlags BookmarkModel::flags(const QModelIndex &index) const
@@ -213,8 +277,6 @@ QMimeData *BookmarkModel::mimeData(const QModelIndexList &indexes) const
 
 bool BookmarkModel::dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent)
 {
-    Q_UNUSED(row)
-
     if (action == Qt::IgnoreAction)
         return true;
 
@@ -231,13 +293,15 @@ bool BookmarkModel::dropMimeData(const QMimeData *data, Qt::DropAction action, i
         return false;
 
     while (!stream.atEnd()) {
-        int row;
+        int source_row;
         qintptr ptr;
-        stream >> row >> ptr;
+        stream >> source_row >> ptr;
 
-        QModelIndex index = createIndex(row, 0, (void *) ptr);
+        QModelIndex index = createIndex(source_row, 0, (void *) ptr);
         BookmarkTreeNode *node = tree_node(index);
         add_bookmark(tree_node(parent), node, row);
+        if (row != -1)
+            row++;
     }
 
     return true;
@@ -253,25 +317,19 @@ bool BookmarkModel::setData(const QModelIndex &index, const QVariant &value, int
         return false;
 
     BookmarkTreeNode *node = tree_node(index);
-
-    switch (role) {
-    case Qt::EditRole:
-    case Qt::DisplayRole:
-        if (index.column() == 0) {
-            node->title = val;
-            break;
-        } else if (index.column() == 1) {
-            node->address = val;
-            break;
-        } else if (index.column() == 2) {
-            node->desc = val;
-            break;
-        }
-    default:
+    if ((role != Qt::EditRole && role != Qt::DisplayRole) || index.column() > 2)
         return false;
+
+    unindex_entry(node);
+    switch (index.column()) {
+    case 0: node->title = val; break;
+    case 1: node->address = val; break;
+    case 2: node->desc = val; break;
     }
+    index_entry(node);
 
-    m_is_dirty = true;
+    m_journal->record_edit(node, index.column(), val);
+    emit dataChanged(index, index);
     return true;
 }
 
@@ -283,22 +341,30 @@ void BookmarkModel::add_bookmark(BookmarkTreeNode *parent, BookmarkTreeNode *nod
     if (parent == node->parent)
         return;
 
-    if (row == -1)
+    if (row < 0 || row > parent->children.count())
         row = parent->children.count();
 
+    const bool is_move = node->parent;
+    const QVector<int> from = is_move ? BookmarkJournal::path(node) : QVector<int>();
+
     if (node->parent) {
         BookmarkTreeNode *parent = node->parent;
-        int row = parent->children.indexOf(node);
-        beginRemoveRows(QModelIndex(), row, row);
+        beginRemoveRows(node_index(parent), node->row, node->row);
         parent->remove(node);
         endRemoveRows();
     }
 
-    beginInsertRows(QModelIndex(), row, row);
-    parent->insert(node);
+    if (!is_move)
+        index_node(node);
+
+    beginInsertRows(node_index(parent), row, row);
+    parent->insert(node, row);
     endInsertRows();
 
-    m_is_dirty = true;
+    if (is_move)
+        m_journal->record_move(from, node);
+    else
+        m_journal->record_insert(node);
 }
 
 void BookmarkModel::remove_bookmark(BookmarkTreeNode *node)
@@ -306,15 +372,15 @@ void BookmarkModel::remove_bookmark(BookmarkTreeNode *node)
     if (!node->parent)
         return;
 
+    m_journal->record_remove(BookmarkJournal::path(node));
+    unindex_node(node);
+
     BookmarkTreeNode *parent = node->parent;
-    int row = parent->children.indexOf(node);
-    beginRemoveRows(QModelIndex(), row, row);
+    beginRemoveRows(node_index(parent), node->row, node->row);
     parent->remove(node);
     endRemoveRows();
 
     delete node;
-
-    m_is_dirty = true;
 }
 
 BookmarkTreeNode *BookmarkModel::tree_node(const QModelIndex &index) const
@@ -322,6 +388,372 @@ BookmarkTreeNode *BookmarkModel::tree_node(const QModelIndex &index) const
     return static_cast<BookmarkTreeNode *>(index.internalPointer());
 }
 
+BookmarkTreeNode *BookmarkModel::root_node() const
+{
+    return m_root_node;
+}
+
+QModelIndex BookmarkModel::node_index(BookmarkTreeNode *node, int column) const
+{
+    if (!node || node == m_root_node)
+        return QModelIndex();
+    return createIndex(node->row, column, node);
+}
+
+bool BookmarkModel::is_bookmarked(const QString &address) const
+{
+    return m_addresses.contains(canonical_address(address));
+}
+
+QList<BookmarkTreeNode *> BookmarkModel::find_bookmarks(const QString &address) const
+{
+    return m_addresses.values(canonical_address(address));
+}
+
+QString BookmarkModel::canonical_address(const QString &address)
+{
+    QUrl url(address);
+    if (!url.isValid())
+        return address;
+
+    url = url.adjusted(QUrl::NormalizePathSegments | QUrl::StripTrailingSlash);
+    if ((url.scheme() == QStringLiteral("http") && url.port() == 80) || (url.scheme() == QStringLiteral("https") && url.port() == 443))
+        url.setPort(-1);
+    return url.toString(QUrl::FullyEncoded);
+}
+
+QSet<BookmarkTreeNode *> BookmarkModel::search(const QString &query)
+{
+    // the token index costs startup time, so it is only built once somebody searches
+    if (!m_has_tokens) {
+        m_has_tokens = true;
+        m_addresses.clear();
+        index_node(m_root_node);
+    }
+
+    QSet<BookmarkTreeNode *> results;
+    const QStringList words = tokens(query);
+    for (int i = 0; i < words.count(); i++) {
+        const QString &word = words.at(i);
+
+        QSet<BookmarkTreeNode *> matches;
+        for (auto it = m_tokens.lowerBound(word); it != m_tokens.constEnd() && it.key().startsWith(word); ++it) {
+            matches.unite(it.value());
+        }
+
+        if (i == 0)
+            results = matches;
+        else
+            results.intersect(matches);
+
+        if (results.isEmpty())
+            break;
+    }
+
+    return results;
+}
+
+QStringList BookmarkModel::tokens(const QString &text)
+{
+    static const QRegularExpression separators(QStringLiteral("[^\\w]+"), QRegularExpression::UseUnicodePropertiesOption);
+    return text.toLower().split(separators, Qt::SkipEmptyParts);
+}
+
+void BookmarkFilterModel::collect(QHash<BookmarkTreeNode *, QVector<BookmarkTreeNode *>> *children, QHash<BookmarkTreeNode *, int> *rows) const
+{
+    if (m_query.isEmpty())
+        return;
+
+    // matches plus the folders above them, never the rest of the tree
+    BookmarkTreeNode *root = m_model->root_node();
+    const QSet<BookmarkTreeNode *> matches = m_model->search(m_query);
+    for (BookmarkTreeNode *node : matches) {
+        while (node != root && node->parent && !rows->contains(node)) {
+            rows->insert(node, 0);
+            (*children)[node->parent].append(node);
+            node = node->parent;
+        }
+    }
+
+    for (auto it = children->begin(); it != children->end(); ++it) {
+        QVector<BookmarkTreeNode *> &siblings = it.value();
+        std::sort(siblings.begin(), siblings.end(), [] (const BookmarkTreeNode *a, const BookmarkTreeNode *b) {
+            return a->row < b->row;
+        });
+        for (int i = 0; i < siblings.count(); i++) {
+            (*rows)[siblings.at(i)] = i;
+        }
+    }
+}
+
+void BookmarkFilterModel::rebuild()
+{
+    m_children.clear();
+    m_rows.clear();
+    collect(&m_children, &m_rows);
+}
+
+void BookmarkFilterModel::refresh()
+{
+    beginResetModel();
+    rebuild();
+    endResetModel();
+}
+
+bool BookmarkFilterModel::update()
+{
+    // most edits leave the results as they are, only a different result list costs a reset
+    if (m_query.isEmpty())
+        return false;
+
+    QHash<BookmarkTreeNode *, QVector<BookmarkTreeNode *>> children;
+    QHash<BookmarkTreeNode *, int> rows;
+    collect(&children, &rows);
+    if (children == m_children)
+        return false;
+
+    beginResetModel();
+    m_children.swap(children);
+    m_rows.swap(rows);
+    endResetModel();
+    return true;
+}
+
+bool BookmarkFilterModel::is_listed(const QModelIndex &source_parent, int first, int last) const
+{
+    // every folder above a listed node is listed too, so checking the top of each subtree is enough
+    BookmarkTreeNode *parent = source_parent.isValid() ? static_cast<BookmarkTreeNode *>(source_parent.internalPointer()) : m_model->root_node();
+    for (int row = first; row <= last && row < parent->children.count(); row++) {
+        if (m_rows.contains(parent->children.at(row)))
+            return true;
+    }
+    return false;
+}
+
+QModelIndex BookmarkFilterModel::source_index(const QModelIndex &index) const
+{
+    return m_model->node_index(static_cast<BookmarkTreeNode *>(index.internalPointer()), index.column());
+}
+
+BookmarkFilterModel::BookmarkFilterModel(BookmarkModel *model, QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_model(model)
+{
+    // nodes are deleted right after rowsRemoved, so drop every pointer to them before that
+    connect(m_model, &QAbstractItemModel::rowsAboutToBeRemoved, this, [this] (const QModelIndex &parent, int first, int last) {
+        if (!is_listed(parent, first, last))
+            return;
+
+        m_is_removing = true;
+        beginResetModel();
+        m_children.clear();
+        m_rows.clear();
+    });
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, [this] {
+        if (!m_is_removing)
+            return;
+
+        m_is_removing = false;
+        rebuild();
+        endResetModel();
+    });
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &BookmarkFilterModel::update);
+    connect(m_model, &QAbstractItemModel::dataChanged, this, [this] (const QModelIndex &top_left, const QModelIndex &bottom_right) {
+        if (update())
+            return;
+
+        for (int row = top_left.row(); row <= bottom_right.row(); row++) {
+            BookmarkTreeNode *node = static_cast<BookmarkTreeNode *>(m_model->index(row, 0, top_left.parent()).internalPointer());
+            auto it = m_rows.constFind(node);
+            if (it != m_rows.constEnd())
+                emit dataChanged(createIndex(it.value(), top_left.column(), node), createIndex(it.value(), bottom_right.column(), node));
+        }
+    });
+}
+
+void BookmarkFilterModel::set_query(const QString &query)
+{
+    if (query == m_query)
+        return;
+
+    m_query = query;
+    refresh();
+}
+
+QVariant BookmarkFilterModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    return m_model->headerData(section, orientation, role);
+}
+
+QVariant BookmarkFilterModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+    return m_model->data(source_index(index), role);
+}
+
+int BookmarkFilterModel::columnCount(const QModelIndex &parent) const
+{
+    return m_model->columnCount(source_index(parent));
+}
+
+int BookmarkFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+
+    BookmarkTreeNode *node = parent.isValid() ? static_cast<BookmarkTreeNode *>(parent.internalPointer()) : m_model->root_node();
+    auto it = m_children.constFind(node);
+    return it == m_children.constEnd() ? 0 : it->count();
+}
+
+QModelIndex BookmarkFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+        return QModelIndex();
+
+    BookmarkTreeNode *node = parent.isValid() ? static_cast<BookmarkTreeNode *>(parent.internalPointer()) : m_model->root_node();
+    return createIndex(row, column, m_children.value(node).at(row));
+}
+
+QModelIndex BookmarkFilterModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid())
+        return QModelIndex();
+
+    BookmarkTreeNode *node = static_cast<BookmarkTreeNode *>(child.internalPointer())->parent;
+    if (!node || node == m_model->root_node())
+        return QModelIndex();
+    return createIndex(m_rows.value(node), 0, node);
+}
+
+Qt::ItemFlags BookmarkFilterModel::flags(const QModelIndex &index) const
+{
+    // results are not a place to drop into, moving happens in the full tree
+    return m_model->flags(source_index(index)) & ~(Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled);
+}
+
+bool BookmarkFilterModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid())
+        return false;
+    return m_model->setData(source_index(index), value, role);
+}
+
+void BookmarkWidget::search(const QString &text)
+{
+    if (text.trimmed().isEmpty()) {
+        m_filter_model->set_query(QString());
+        m_tree_view->setModel(browser->bookmark_model());
+        m_tree_view->setDragEnabled(true);
+        return;
+    }
+
+    m_filter_model->set_query(text);
+    if (m_tree_view->model() != m_filter_model) {
+        m_tree_view->setModel(m_filter_model);
+        m_tree_view->setDragEnabled(false);
+    }
+    m_tree_view->expandAll();
+}
+
+void BookmarkWidget::check_links(BookmarkTreeNode *node)
+{
+    QStringList addresses;
+    QSet<QString> seen;
+    QVector<BookmarkTreeNode *> stack { node };
+    while (!stack.isEmpty()) {
+        BookmarkTreeNode *current = stack.takeLast();
+        stack << current->children;
+
+        const QUrl url(current->address);
+        if (current->type != BookmarkTreeNode::Address || (url.scheme() != QStringLiteral("http") && url.scheme() != QStringLiteral("https")))
+            continue;
+        if (!seen.contains(current->address)) {
+            seen.insert(current->address);
+            addresses.append(current->address);
+        }
+    }
+
+    QDialog *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle(QStringLiteral("Check Links"));
+    dialog->resize(720, 400);
+
+    QLabel *progress = new QLabel(QStringLiteral("Checking %1 links...").arg(addresses.count()));
+    QTreeWidget *results = new QTreeWidget;
+    results->setHeaderLabels({ QStringLiteral("Status"), QStringLiteral("Address"), QStringLiteral("Moved to") });
+    results->setRootIsDecorated(false);
+
+    QPushButton *update_button = new QPushButton(QStringLiteral("Update Moved Bookmarks"));
+    update_button->setEnabled(false);
+    QPushButton *close_button = new QPushButton(QStringLiteral("Close"));
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    buttons->addStretch();
+    buttons->addWidget(update_button);
+    buttons->addWidget(close_button);
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    dialog->setLayout(vbox);
+    vbox->addWidget(progress);
+    vbox->addWidget(results);
+    vbox->addLayout(buttons);
+
+    // the checker belongs to the dialog, closing it cancels whatever is still in flight
+    LinkChecker *checker = new LinkChecker(dialog);
+    QSharedPointer<QHash<QString, QString>> moved(new QHash<QString, QString>);
+    QSharedPointer<int> checked(new int(0));
+    const int total = addresses.count();
+
+    checker->check(addresses, dialog, [progress, results, update_button, moved, checked, total] (const LinkCheckResult &result) {
+        ++*checked;
+        progress->setText(QStringLiteral("Checked %1 of %2 links").arg(*checked).arg(total));
+
+        QString status;
+        switch (result.status) {
+        case LinkCheckResult::Ok:
+            return;
+        case LinkCheckResult::Redirected:
+            status = QStringLiteral("Redirected");
+            break;
+        case LinkCheckResult::Moved:
+            status = QStringLiteral("Moved");
+            moved->insert(result.address, result.location);
+            update_button->setEnabled(true);
+            break;
+        case LinkCheckResult::Broken:
+            status = QStringLiteral("Broken (%1)").arg(result.http_status);
+            break;
+        case LinkCheckResult::Failed:
+            status = result.error;
+            break;
+        }
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(results);
+        item->setText(0, status);
+        item->setText(1, result.address);
+        item->setText(2, result.location);
+    }, [progress, checked, total] {
+        progress->setText(QStringLiteral("Checked %1 of %2 links, done").arg(*checked).arg(total));
+    });
+
+    connect(update_button, &QPushButton::clicked, dialog, [update_button, moved] {
+        BookmarkModel *model = browser->bookmark_model();
+        for (auto it = moved->constBegin(); it != moved->constEnd(); ++it) {
+            const QList<BookmarkTreeNode *> nodes = model->find_bookmarks(it.key());
+            for (BookmarkTreeNode *node : nodes) {
+                model->setData(model->node_index(node, 1), it.value());
+            }
+        }
+        moved->clear();
+        update_button->setEnabled(false);
+    });
+    connect(close_button, &QPushButton::clicked, dialog, &QDialog::close);
+
+    dialog->show();
+}
+
 void BookmarkWidget::show_context_menu(const QPoint &pos)
 {
     QModelIndex index = m_tree_view->indexAt(pos);
@@ -355,6 +787,11 @@ void BookmarkWidget::show_context_menu(const QPoint &pos)
                 folder->title = QStringLiteral("New Folder");
                 browser->bookmark_model()->add_bookmark(node, folder);
             });
+
+            QAction *check_links = menu->addAction(QStringLiteral("Check links"));
+            connect(check_links, &QAction::triggered, [this, node] {
+                this->check_links(node);
+            });
         }
 
         menu->addSeparator();
@@ -370,6 +807,11 @@ void BookmarkWidget::show_context_menu(const QPoint &pos)
             folder->title = QStringLiteral("New Folder");
             browser->bookmark_model()->add_bookmark(nullptr, folder);
         });
+
+        QAction *check_links = menu->addAction(QStringLiteral("Check links"));
+        connect(check_links, &QAction::triggered, [this] {
+            this->check_links(browser->bookmark_model()->root_node());
+        });
     }
 
 
@@ -404,8 +846,13 @@ void BookmarkWidget::open_in_new_tab(const QModelIndex &index)
 BookmarkWidget::BookmarkWidget(QWidget *parent)
     : QWidget(parent)
 {
+    m_search_bar = new QLineEdit;
+    m_search_bar->setPlaceholderText(QStringLiteral("Search bookmarks"));
+    m_search_bar->setClearButtonEnabled(true);
+
     m_tree_view = new QTreeView;
     m_tree_view->setModel(browser->bookmark_model());
+    m_filter_model = new BookmarkFilterModel(browser->bookmark_model(), this);
 
     m_tree_view->setDragEnabled(true);
     m_tree_view->setAcceptDrops(true);
@@ -414,8 +861,11 @@ BookmarkWidget::BookmarkWidget(QWidget *parent)
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->setContentsMargins(0, 0, 0, 0);
     setLayout(vbox);
+    vbox->addWidget(m_search_bar);
     vbox->addWidget(m_tree_view);
 
+    connect(m_search_bar, &QLineEdit::textChanged, this, &BookmarkWidget::search);
+
     m_tree_view->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(m_tree_view, &QTreeView::customContextMenuRequested, this, &BookmarkWidget::show_context_menu);
     connect(m_tree_view, &QTreeView::doubleClicked, this, &BookmarkWidget::open_in_new_tab);
@@ -451,6 +901,16 @@ BookmarkTreeNode *XbelReader::read(QIODevice *device)
     return node;
 }
 
+quint32 XbelReader::journal_generation() const
+{
+    return m_journal_generation;
+}
+
+qint64 XbelReader::journal_offset() const
+{
+    return m_journal_offset;
+}
+
 void XbelReader::readXBEL(BookmarkTreeNode *node)
 {
     while (readNextStartElement()) {
@@ -458,11 +918,24 @@ void XbelReader::readXBEL(BookmarkTreeNode *node)
             readFolder(node);
         else if (name() == QLatin1String("bookmark"))
             readBookmarkTreeNode(node);
+        else if (name() == QLatin1String("info"))
+            readInfo();
         else
             skipCurrentElement();
     }
 }
 
+void XbelReader::readInfo()
+{
+    while (readNextStartElement()) {
+        if (name() == QLatin1String("metadata") && attributes().value(QLatin1String("owner")) == QLatin1String("crusta")) {
+            m_journal_generation = attributes().value(QLatin1String("generation")).toUInt();
+            m_journal_offset = attributes().value(QLatin1String("offset")).toLongLong();
+        }
+        skipCurrentElement();
+    }
+}
+
 void XbelReader::readTitle(BookmarkTreeNode *node)
 {
     node->title = readElementText();
@@ -527,6 +1000,15 @@ bool XbelWriter::write(QIODevice *device, BookmarkTreeNode *node)
     writeDTD(QLatin1String("<!DOCTYPE xbel>"));
     writeStartElement(QLatin1String("xbel"));
     writeAttribute(QLatin1String("version"), QLatin1String("1.0"));
+    if (m_journal_generation != 0) {
+        writeStartElement(QLatin1String("info"));
+        writeStartElement(QLatin1String("metadata"));
+        writeAttribute(QLatin1String("owner"), QLatin1String("crusta"));
+        writeAttribute(QLatin1String("generation"), QString::number(m_journal_generation));
+        writeAttribute(QLatin1String("offset"), QString::number(m_journal_offset));
+        writeEndElement();
+        writeEndElement();
+    }
     if (node->type == BookmarkTreeNode::Root) {
         for (int i = 0; i < node->children.count(); i++) {
             write_item(node->children.at(i));
@@ -539,6 +1021,12 @@ bool XbelWriter::write(QIODevice *device, BookmarkTreeNode *node)
     return true;
 }
 
+void XbelWriter::set_journal_position(quint32 generation, qint64 offset)
+{
+    m_journal_generation = generation;
+    m_journal_offset = offset;
+}
+
 void XbelWriter::write_item(BookmarkTreeNode *node)
 {
     switch (node->type) {
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QLineEdit>
+#include <QMap>
+#include <QMultiHash>
+#include <QSet>
 #include <QTreeView>
 #include <QWidget>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
+class BookmarkJournal;
+
 #define BOOKMARK_MIMETYPE QStringLiteral("application/bookmark.crusta")
 
 class BookmarkTreeNode
@@ -29,6 +36,7 @@ public:
     QString desc;
 
     BookmarkTreeNode *parent = nullptr;
+    int row = 0;
     Type type;
     QVector<BookmarkTreeNode *> children;
 
@@ -57,9 +65,16 @@ public:
 
 class BookmarkModel : public QAbstractItemModel
 {
-    bool m_is_dirty = false;
     BookmarkTreeNode *m_root_node = nullptr;
-    void save();
+    BookmarkJournal *m_journal = nullptr;
+    QMultiHash<QString, BookmarkTreeNode *> m_addresses;
+    QMap<QString, QSet<BookmarkTreeNode *>> m_tokens;
+    bool m_has_tokens = false;
+
+    void index_entry(BookmarkTreeNode *node);
+    void unindex_entry(BookmarkTreeNode *node);
+    void index_node(BookmarkTreeNode *node);
+    void unindex_node(BookmarkTreeNode *node);
 public:
     explicit BookmarkModel(QObject *parent = nullptr);
     ~BookmarkModel();
@@ -80,11 +95,54 @@ public:
     void add_bookmark(BookmarkTreeNode *parent, BookmarkTreeNode *node, int row = -1);
     void remove_bookmark(BookmarkTreeNode *node);
     BookmarkTreeNode *tree_node(const QModelIndex &index) const;
+    BookmarkTreeNode *root_node() const;
+    QModelIndex node_index(BookmarkTreeNode *node, int column = 0) const;
+
+    bool is_bookmarked(const QString &address) const;
+    QList<BookmarkTreeNode *> find_bookmarks(const QString &address) const;
+    static QString canonical_address(const QString &address);
+
+    QSet<BookmarkTreeNode *> search(const QString &query);
+    static QStringList tokens(const QString &text);
+};
+
+class BookmarkFilterModel : public QAbstractItemModel
+{
+    BookmarkModel *m_model = nullptr;
+    QString m_query;
+    QHash<BookmarkTreeNode *, QVector<BookmarkTreeNode *>> m_children;
+    QHash<BookmarkTreeNode *, int> m_rows;
+    bool m_is_removing = false;
+
+    void collect(QHash<BookmarkTreeNode *, QVector<BookmarkTreeNode *>> *children, QHash<BookmarkTreeNode *, int> *rows) const;
+    void rebuild();
+    void refresh();
+    bool update();
+    bool is_listed(const QModelIndex &source_parent, int first, int last) const;
+    QModelIndex source_index(const QModelIndex &index) const;
+public:
+    explicit BookmarkFilterModel(BookmarkModel *model, QObject *parent = nullptr);
+
+    void set_query(const QString &query);
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
 };
 
 class BookmarkWidget : public QWidget
 {
+    QLineEdit *m_search_bar = nullptr;
     QTreeView *m_tree_view = nullptr;
+    BookmarkFilterModel *m_filter_model = nullptr;
+
+    void search(const QString &text);
+    void check_links(BookmarkTreeNode *node);
 
     void show_context_menu(const QPoint &pos);
     void open_in_new_tab(const QModelIndex &index);
@@ -100,8 +158,15 @@ public:
     BookmarkTreeNode *read(const QString &file_name);
     BookmarkTreeNode *read(QIODevice *device);
 
+    quint32 journal_generation() const;
+    qint64 journal_offset() const;
+
 private:
+    quint32 m_journal_generation = 0;
+    qint64 m_journal_offset = 0;
+
     void readXBEL(BookmarkTreeNode *node);
+    void readInfo();
     void readTitle(BookmarkTreeNode *node);
     void readFolder(BookmarkTreeNode *node);
     void readDescription(BookmarkTreeNode *node);
@@ -114,7 +179,11 @@ public:
     explicit XbelWriter();
     bool write(const QString &file_name, BookmarkTreeNode *node);
     bool write(QIODevice *device, BookmarkTreeNode *node);
+    void set_journal_position(quint32 generation, qint64 offset);
 
 private:
+    quint32 m_journal_generation = 0;
+    qint64 m_journal_offset = 0;
+
     void write_item(BookmarkTreeNode *node);
 };
@@ -3,12 +3,23 @@
 #include "browser.h"
 #include "browser_window.h"
 #include "browser_schemes.h"
+#include "completion.h"
+#include "database.h"
 #include "downloads.h"
 #include "history.h"
+#include "history_index.h"
+#include "history_retention.h"
+#include "memory_pressure.h"
 #include "plugins.h"
+#include "preloader.h"
+#include "renderer_scheduler.h"
 #include "request_interceptor.h"
 #include "search_engine.h"
+#include "session.h"
 #include "tab.h"
+#include "tab_pool.h"
+#include "task_manager.h"
+#include "thumbnails.h"
 #include "webview.h"
 
 #include <QApplication>
@@ -18,9 +29,8 @@
 #include <QDir>
 #include <QFile>
 #include <QIcon>
+#include <QPixmapCache>
 #include <QSettings>
-#include <QSqlError>
-#include <QSqlQuery>
 #include <QStandardPaths>
 #include <QStyleFactory>
 #include <QTextStream>
@@ -31,6 +41,10 @@
 #include <QWebEngineSettings>
 #include <QWidget>
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
 void Browser::setup_web_profile()
 {
     m_web_profile = QWebEngineProfile::defaultProfile();
@@ -95,32 +109,89 @@ void Browser::setup_web_profile()
 
 void Browser::setup_database()
 {
-    const QString driver = QStringLiteral("QSQLITE");
-    if (!QSqlDatabase::isDriverAvailable(driver)) {
-        qDebug() << "Driver not available";
-        return;
-    }
-
-    m_database = QSqlDatabase::addDatabase(driver);
-    if (m_is_private) {
-        m_database.setDatabaseName(QStringLiteral(":memory:"));
-    } else {
+    QString path = QStringLiteral(":memory:");
+    if (!m_is_private) {
         QDir standardLocation(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
-        const QString dbPath = standardLocation.absoluteFilePath(QStringLiteral("database"));
-        m_database.setDatabaseName(dbPath);
+        path = standardLocation.absoluteFilePath(QStringLiteral("database"));
     }
 
-    m_database.open();
-    if (!m_database.isOpen()) {
-        qDebug() << m_database.lastError();
-        return;
-    }
+    m_database = new Database(path);
+}
 
-    QSqlQuery query;
-    query.prepare(QStringLiteral("CREATE TABLE IF NOT EXISTS history (title TEXT, address TEXT UNIQUE, icon BLOB, last_visited DATETIME)"));
-    if (!query.exec()) {
-        qDebug() << query.lastError();
-    }
+void Browser::setup_memory_pressure()
+{
+    m_memory_pressure = new MemoryPressureMonitor;
+
+    m_memory_pressure->add_responder(MemoryPressureMonitor::DropCaches, QStringLiteral("pixmap cache"), m_memory_pressure, [] {
+        QPixmapCache::clear();
+        return -1;
+    });
+    m_memory_pressure->add_responder(MemoryPressureMonitor::DropCaches, QStringLiteral("preloaded page"), m_preloader, [this] {
+        m_preloader->discard();
+        return -1;
+    });
+    m_memory_pressure->add_responder(MemoryPressureMonitor::DropCaches, QStringLiteral("spare tabs"), m_tab_pool, [this] {
+        m_tab_pool->release();
+        return -1;
+    });
+    m_memory_pressure->add_responder(MemoryPressureMonitor::DropCaches, QStringLiteral("tab thumbnails"), m_thumbnail_cache, [this] {
+        m_thumbnail_cache->clear();
+        return -1;
+    });
+
+#ifdef __GLIBC__
+    m_memory_pressure->add_responder(MemoryPressureMonitor::TrimHeap, QStringLiteral("malloc_trim"), m_memory_pressure, [] {
+        malloc_trim(0);
+        return -1;
+    });
+#endif
+
+    auto suspend_background_tabs = [] (QWebEnginePage::LifecycleState state) {
+        QSet<qint64> pids;
+        QList<BrowserWindow *> windows;
+        for (QWidget *widget : QApplication::topLevelWidgets()) {
+            if (BrowserWindow *window = dynamic_cast<BrowserWindow *>(widget)) {
+                windows.append(window);
+                pids.unite(window->suspend_background_tabs(state));
+            }
+        }
+
+        // a renderer that still serves a tab keeps its memory, only renderers left without one are counted
+        for (BrowserWindow *window : qAsConst(windows)) {
+            const QList<Tab *> tabs = window->tabs();
+            for (Tab *tab : tabs) {
+                WebTab *web_tab = dynamic_cast<WebTab *>(tab);
+                if (!web_tab || !web_tab->has_webview())
+                    continue;
+
+                const QWebEnginePage *page = web_tab->webview()->page();
+                if (page->lifecycleState() != QWebEnginePage::LifecycleState::Discarded)
+                    pids.remove(page->renderProcessPid());
+            }
+        }
+
+        qint64 bytes = 0;
+        for (qint64 pid : qAsConst(pids)) {
+            bytes += qMax<qint64>(0, ProcessSampler::resident_bytes(pid));
+        }
+        return bytes;
+    };
+    m_memory_pressure->add_responder(MemoryPressureMonitor::FreezeTabs, QStringLiteral("freeze background tabs"), m_memory_pressure, [suspend_background_tabs] {
+        // frozen renderers keep their memory, so only the browser's own change is counted
+        suspend_background_tabs(QWebEnginePage::LifecycleState::Frozen);
+        return -1;
+    });
+    m_memory_pressure->add_responder(MemoryPressureMonitor::DiscardTabs, QStringLiteral("discard background tabs"), m_memory_pressure, [suspend_background_tabs] {
+        return suspend_background_tabs(QWebEnginePage::LifecycleState::Discarded);
+    });
+
+    m_memory_pressure->add_responder(MemoryPressureMonitor::ClearHttpCache, QStringLiteral("HTTP memory cache"), m_web_profile, [this] {
+        if (m_web_profile->httpCacheType() != QWebEngineProfile::MemoryHttpCache)
+            return 0;
+
+        m_web_profile->clearHttpCache();
+        return -1;
+    });
 }
 
 void Browser::load_settings()
@@ -168,15 +239,22 @@ void Browser::load_settings()
 
 Browser::~Browser()
 {
-    if (m_database.isOpen())
-        m_database.close();
-
+    delete m_session_manager;
+    delete m_tab_pool;
+    delete m_thumbnail_cache;
+    delete m_memory_pressure;
+    delete m_preloader;
+    delete m_renderer_scheduler;
+    delete m_completer;
+    delete m_history_retention;
+    delete m_history_indexer;
     delete m_adblock;
     delete m_history_model;
     delete m_bookmark_model;
     delete m_search_model;
     delete m_plugins;
     delete m_download_widget;
+    delete m_database;
 }
 
 int Browser::start(int argc, char **argv)
@@ -210,12 +288,25 @@ int Browser::start(int argc, char **argv)
 
     m_adblock = new Adblock;
     m_history_model = new HistoryModel;
+    if (!m_is_private) {
+        m_history_indexer = new HistoryIndexer(m_database);
+        m_history_retention = new HistoryRetention(m_database, m_history_model);
+    }
     m_bookmark_model = new BookmarkModel;
+    m_completer = new Completer(m_database, m_history_model, m_bookmark_model);
+    m_preloader = new Preloader;
+    m_renderer_scheduler = new RendererScheduler;
     m_search_model = new SearchModel;
     m_plugins = new Plugins;
+    if (!m_is_private)
+        m_session_manager = new SessionManager(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
 
     load_settings();
-    create_browser_window();
+    m_tab_pool = new TabPool;
+    m_thumbnail_cache = new ThumbnailCache(m_is_private ? QString() : QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath(QStringLiteral("thumbnails")));
+    setup_memory_pressure();
+    if (!m_session_manager || !m_session_manager->restore())
+        create_browser_window();
     return app.exec();
 }
 
@@ -246,6 +337,11 @@ bool Browser::is_private() const
     return m_is_private;
 }
 
+Database *Browser::database() const
+{
+    return m_database;
+}
+
 Adblock *Browser::adblock() const
 {
     return m_adblock;
@@ -256,16 +352,56 @@ HistoryModel *Browser::history_model() const
     return m_history_model;
 }
 
+HistoryIndexer *Browser::history_indexer() const
+{
+    return m_history_indexer;
+}
+
 BookmarkModel *Browser::bookmark_model() const
 {
     return m_bookmark_model;
 }
 
+Completer *Browser::completer() const
+{
+    return m_completer;
+}
+
+Preloader *Browser::preloader() const
+{
+    return m_preloader;
+}
+
+RendererScheduler *Browser::renderer_scheduler() const
+{
+    return m_renderer_scheduler;
+}
+
 SearchModel *Browser::search_model() const
 {
     return m_search_model;
 }
 
+SessionManager *Browser::session_manager() const
+{
+    return m_session_manager;
+}
+
+TabPool *Browser::tab_pool() const
+{
+    return m_tab_pool;
+}
+
+ThumbnailCache *Browser::thumbnail_cache() const
+{
+    return m_thumbnail_cache;
+}
+
+MemoryPressureMonitor *Browser::memory_pressure() const
+{
+    return m_memory_pressure;
+}
+
 Plugins *Browser::plugins() const
 {
     return m_plugins;
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <QByteArray>
-#include <QSqlDatabase>
 #include <QWebEngineProfile>
 
 #define browser Browser::instance()
@@ -9,8 +8,18 @@
 class Adblock;
 class BookmarkModel;
 class BrowserWindow;
+class Completer;
+class Database;
+class HistoryIndexer;
 class HistoryModel;
+class HistoryRetention;
+class MemoryPressureMonitor;
+class Preloader;
+class RendererScheduler;
 class SearchModel;
+class SessionManager;
+class TabPool;
+class ThumbnailCache;
 class Plugins;
 class DownloadWidget;
 
@@ -20,16 +29,26 @@ class Browser
 
     QWebEngineProfile *m_web_profile = nullptr;
 
-    QSqlDatabase m_database;
+    Database *m_database = nullptr;
     Adblock *m_adblock = nullptr;
     HistoryModel *m_history_model = nullptr;
+    HistoryIndexer *m_history_indexer = nullptr;
+    HistoryRetention *m_history_retention = nullptr;
     BookmarkModel *m_bookmark_model = nullptr;
+    Completer *m_completer = nullptr;
+    Preloader *m_preloader = nullptr;
+    RendererScheduler *m_renderer_scheduler = nullptr;
     SearchModel *m_search_model = nullptr;
+    SessionManager *m_session_manager = nullptr;
+    TabPool *m_tab_pool = nullptr;
+    ThumbnailCache *m_thumbnail_cache = nullptr;
+    MemoryPressureMonitor *m_memory_pressure = nullptr;
     Plugins *m_plugins = nullptr;
     DownloadWidget *m_download_widget = nullptr;
 
     void setup_web_profile();
     void setup_database();
+    void setup_memory_pressure();
     void load_settings();
 public:
     ~Browser();
@@ -41,10 +60,19 @@ public:
 
     bool is_private() const;
 
+    Database *database() const;
     Adblock *adblock() const;
     HistoryModel *history_model() const;
+    HistoryIndexer *history_indexer() const;
     BookmarkModel *bookmark_model() const;
+    Completer *completer() const;
+    Preloader *preloader() const;
+    RendererScheduler *renderer_scheduler() const;
     SearchModel *search_model() const;
+    SessionManager *session_manager() const;
+    TabPool *tab_pool() const;
+    ThumbnailCache *thumbnail_cache() const;
+    MemoryPressureMonitor *memory_pressure() const;
     Plugins *plugins() const;
     DownloadWidget *download_widget() const;
 
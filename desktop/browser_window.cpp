@@ -3,7 +3,13 @@
 #include "browser_window.h"
 #include "browser_window_p.h"
 #include "history.h"
+#include "history_import.h"
+#include "renderer_scheduler.h"
+#include "session.h"
 #include "tab.h"
+#include "tab_lifecycle.h"
+#include "tab_pool.h"
+#include "thumbnails.h"
 #include "webview.h"
 
 #include <QApplication>
@@ -31,7 +37,7 @@ void BrowserWindow::setup_menubar()
 
     QAction *open_new_tab = file->addAction(QStringLiteral("New Tab"));
     open_new_tab->setShortcut(QKeySequence::AddTab);
-    connect(open_new_tab, &QAction::triggered, this, &BrowserWindow::add_new_tab);
+    connect(open_new_tab, &QAction::triggered, this, &BrowserWindow::open_new_tab);
 
     QAction *open_new_window = file->addAction(QStringLiteral("New Window"));
     open_new_window->setShortcut(QKeySequence::New);
@@ -263,6 +269,13 @@ void BrowserWindow::setup_menubar()
 
     view->addSeparator();
 
+    QAction *tab_overview = view->addAction(QStringLiteral("Tab Overview"));
+    tab_overview->setShortcut(Qt::SHIFT + Qt::CTRL + Qt::Key_A);
+    connect(tab_overview, &QAction::triggered, [this] {
+        TabOverview *overview = new TabOverview(this);
+        overview->show();
+    });
+
     QAction *show_all_history = history->addAction(QStringLiteral("Show All History"));
     connect(show_all_history, &QAction::triggered, [this] {
         ManagerTab *manager = new ManagerTab;
@@ -330,7 +343,28 @@ void BrowserWindow::setup_menubar()
         browser->history_model()->remove_all();
     });
 
-    QAction *bookmark_this_tab = bookmarks->addAction(QStringLiteral("Boomark This Tab"));
+    history->addSeparator();
+
+    QAction *import_history = history->addAction(QStringLiteral("Import History..."));
+    connect(import_history, &QAction::triggered, [this] {
+        const QString path = QFileDialog::getOpenFileName(this, QStringLiteral("Import History"), QString(),
+                                                          QStringLiteral("Browser History (History places.sqlite);;All Files (*)"));
+        if (path.isEmpty())
+            return ;
+
+        HistoryImporter importer(browser->database());
+        importer.import(path, this, [this] (const HistoryImportResult &result) {
+            if (!result.error.isEmpty()) {
+                QMessageBox::warning(this, QStringLiteral("Import History"), result.error);
+                return ;
+            }
+
+            browser->history_model()->reload();
+            QMessageBox::information(this, QStringLiteral("Import History"), QStringLiteral("Imported %1 history entries.").arg(result.imported));
+        });
+    });
+
+    QAction *bookmark_this_tab = bookmarks->addAction(QStringLiteral("Bookmark This Tab"));
     connect(bookmark_this_tab, &QAction::triggered, [this] {
         WebTab *tab = dynamic_cast<WebTab *>(m_central_widget->current_tab());
         if (!tab)
@@ -347,10 +381,7 @@ void BrowserWindow::setup_menubar()
             if (!tab)
                 continue;
 
-            BookmarkTreeNode *node = new BookmarkTreeNode(BookmarkTreeNode::Address);
-            node->title = tab->webview()->title();
-            node->address = tab->webview()->url().toString();
-            browser->bookmark_model()->add_bookmark(nullptr, node);
+            tab->bookmark();
         }
     });
 
@@ -409,6 +440,14 @@ void BrowserWindow::setup_menubar()
         browser->web_profile()->clearHttpCache();
     });
 
+    QAction *task_manager = tools->addAction(QStringLiteral("Task Manager"));
+    task_manager->setShortcut(Qt::SHIFT + Qt::Key_Escape);
+    connect(task_manager, &QAction::triggered, [this] {
+        ManagerTab *manager = new ManagerTab;
+        add_existing_tab(manager);
+        manager->open_tasks();
+    });
+
     QAction *preferences = tools->addAction(QStringLiteral("Preferences"));
     connect(preferences, &QAction::triggered, [this] {
         ManagerTab *manager = new ManagerTab;
@@ -434,6 +473,9 @@ BrowserWindow::BrowserWindow(QWidget *parent)
     resize(800, 600);
     restoreGeometry(settings.value(QStringLiteral("browser_window/geometry")).toByteArray());
     restoreState(settings.value(QStringLiteral("browser_window/window_state")).toByteArray());
+
+    if (SessionManager *session_manager = browser->session_manager())
+        session_manager->add_window(this);
 }
 
 Tab *BrowserWindow::add_new_tab()
@@ -441,31 +483,82 @@ Tab *BrowserWindow::add_new_tab()
     return m_central_widget->add_new_tab();
 }
 
+Tab *BrowserWindow::open_new_tab()
+{
+    return m_central_widget->open_new_tab();
+}
+
 Tab *BrowserWindow::add_existing_tab(Tab *tab)
 {
     return m_central_widget->add_existing_tab(tab);
 }
 
+WebTab *BrowserWindow::add_background_tab(const QUrl &url, const QString &title, const QIcon &icon)
+{
+    return m_central_widget->add_background_tab(url, title, icon);
+}
+
+void BrowserWindow::remove_tab(int index)
+{
+    m_central_widget->remove_tab(index);
+}
+
+int BrowserWindow::current_index() const
+{
+    return m_central_widget->current_index();
+}
+
+void BrowserWindow::set_current_index(int index)
+{
+    m_central_widget->set_current_index(index);
+}
+
 QList<Tab *> BrowserWindow::tabs() const
 {
     return m_central_widget->tabs();
 }
 
+QSet<qint64> BrowserWindow::suspend_background_tabs(QWebEnginePage::LifecycleState state)
+{
+    return m_central_widget->suspend_background_tabs(state);
+}
+
+bool BrowserWindow::suspend_tab(WebTab *tab, QWebEnginePage::LifecycleState state)
+{
+    return m_central_widget->suspend_tab(tab, state);
+}
+
 void BrowserWindow::closeEvent(QCloseEvent *event)
 {
     QSettings settings;
     settings.setValue(QStringLiteral("browser_window/geometry"), saveGeometry());
     settings.setValue(QStringLiteral("browser_window/window_state"), saveState());
+
+    if (SessionManager *session_manager = browser->session_manager())
+        session_manager->close_window();
+
     QMainWindow::closeEvent(event);
 }
 
 void CentralWidget::setup_tabbar()
 {
-    connect(m_tabbar, &NormalTabbar::currentChanged, m_stacked_widget, &QStackedWidget::setCurrentIndex);
+    connect(m_tabbar, &NormalTabbar::currentChanged, [this](int index) {
+        // grab the outgoing tab while its view is still on screen
+        if (WebTab *tab = dynamic_cast<WebTab *>(m_stacked_widget->currentWidget()))
+            browser->thumbnail_cache()->capture(tab);
+        m_stacked_widget->setCurrentIndex(index);
+    });
     connect(m_tabbar, &NormalTabbar::tabMoved, [this](int from, int to) {
         m_stacked_widget->insertWidget(to, m_stacked_widget->widget(from));
+        if (SessionManager *session_manager = browser->session_manager())
+            session_manager->schedule_save();
+    });
+    connect(m_tabbar, &NormalTabbar::currentChanged, [] {
+        browser->renderer_scheduler()->schedule_update();
+        if (SessionManager *session_manager = browser->session_manager())
+            session_manager->schedule_save();
     });
-    connect(m_tabbar, &NormalTabbar::new_tab_requested, this, &CentralWidget::add_new_tab);
+    connect(m_tabbar, &NormalTabbar::new_tab_requested, this, &CentralWidget::open_new_tab);
     connect(m_tabbar, &NormalTabbar::tabCloseRequested, this, &CentralWidget::remove_tab);
 
     connect(m_tabbar, &NormalTabbar::customContextMenuRequested, this, &CentralWidget::showNormalTabbarContextMenu);
@@ -481,7 +574,7 @@ void CentralWidget::showNormalTabbarContextMenu(const QPoint &pos)
     WebTab *web_tab = dynamic_cast<WebTab *>(tab);
 
     QMenu *menu = new QMenu;
-    if (web_tab) {
+    if (web_tab && web_tab->has_webview()) {
         QAction *reload = menu->addAction(QStringLiteral("Reload"));
         QAction *mute = menu->addAction(QStringLiteral("Mute Tab"));
         if (web_tab->webview()->page()->isAudioMuted()) {
@@ -497,6 +590,12 @@ void CentralWidget::showNormalTabbarContextMenu(const QPoint &pos)
             web_tab->webview()->page()->setAudioMuted(!web_tab->webview()->page()->isAudioMuted());
         });
     }
+    if (web_tab) {
+        QAction *pin = menu->addAction(web_tab->is_pinned() ? QStringLiteral("Unpin Tab") : QStringLiteral("Pin Tab"));
+        connect(pin, &QAction::triggered, [web_tab] {
+            web_tab->set_pinned(!web_tab->is_pinned());
+        });
+    }
     QAction *close_tab = menu->addAction(QStringLiteral("Close Tab"));
     QAction *close_other_tabs = menu->addAction(QStringLiteral("Close Other Tabs"));
 
@@ -544,6 +643,7 @@ CentralWidget::CentralWidget(QWidget *parent)
     vbox->addWidget(m_stacked_widget);
 
     setup_tabbar();
+    m_lifecycle = new TabLifecycle(m_tabbar, m_stacked_widget, this);
 
     add_new_tab();
 }
@@ -554,11 +654,46 @@ Tab *CentralWidget::add_new_tab()
     return add_existing_tab(tab);
 }
 
+Tab *CentralWidget::open_new_tab()
+{
+    WebTab *tab = browser->tab_pool()->take();
+    if (!tab) {
+        tab = new WebTab;
+        tab->webview()->home();
+    }
+
+    add_existing_tab(tab);
+    tab->address_bar()->setFocus();
+    return tab;
+}
+
 Tab *CentralWidget::add_existing_tab(Tab *tab)
 {
-    int index = m_tabbar->addTab(QStringLiteral("New Tab"));
+    insert_tab(tab);
+    m_tabbar->setCurrentIndex(m_stacked_widget->indexOf(tab));
+    return tab;
+}
+
+WebTab *CentralWidget::add_background_tab(const QUrl &url, const QString &title, const QIcon &icon)
+{
+    WebTab *tab = new WebTab(url, title, icon);
+    insert_tab(tab);
+
+    const int index = m_stacked_widget->indexOf(tab);
+    m_tabbar->setTabText(index, tab->title());
+    m_tabbar->setTabIcon(index, tab->icon());
+    m_tabbar->setTabToolTip(index, url.toString());
+    return tab;
+}
+
+void CentralWidget::insert_tab(Tab *tab)
+{
+    m_tabbar->addTab(QStringLiteral("New Tab"));
     m_stacked_widget->addWidget(tab);
-    m_tabbar->setCurrentIndex(index);
+    m_lifecycle->add_tab(tab);
+
+    if (SessionManager *session_manager = browser->session_manager())
+        session_manager->schedule_save();
 
     connect(tab, &Tab::title_changed, [this, tab] (const QString &title) {
         int index = m_stacked_widget->indexOf(tab);
@@ -569,8 +704,6 @@ Tab *CentralWidget::add_existing_tab(Tab *tab)
         int index = m_stacked_widget->indexOf(tab);
         m_tabbar->setTabIcon(index, icon);
     });
-
-    return tab;
 }
 
 void CentralWidget::remove_tab(int index)
@@ -583,6 +716,10 @@ void CentralWidget::remove_tab(int index)
     m_tabbar->removeTab(index);
     m_stacked_widget->removeWidget(tab);
     tab->deleteLater();
+
+    browser->renderer_scheduler()->schedule_update();
+    if (SessionManager *session_manager = browser->session_manager())
+        session_manager->schedule_save();
 }
 
 int CentralWidget::current_index() const
@@ -590,6 +727,11 @@ int CentralWidget::current_index() const
     return m_stacked_widget->currentIndex();
 }
 
+void CentralWidget::set_current_index(int index)
+{
+    m_tabbar->setCurrentIndex(index);
+}
+
 Tab *CentralWidget::current_tab() const
 {
     return dynamic_cast<Tab *>(m_stacked_widget->currentWidget());
@@ -606,6 +748,16 @@ QList<Tab *> CentralWidget::tabs() const
     return list;
 }
 
+QSet<qint64> CentralWidget::suspend_background_tabs(QWebEnginePage::LifecycleState state)
+{
+    return m_lifecycle->suspend(state);
+}
+
+bool CentralWidget::suspend_tab(WebTab *tab, QWebEnginePage::LifecycleState state)
+{
+    return m_lifecycle->suspend_tab(tab, state);
+}
+
 NormalTabbar::NormalTabbar(QWidget *parent)
     : QTabBar(parent)
 {
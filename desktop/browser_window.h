@@ -1,14 +1,18 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QSet>
 #include <QStackedWidget>
 #include <QTabBar>
 #include <QToolBar>
 #include <QToolButton>
+#include <QUrl>
+#include <QWebEnginePage>
 #include <QWidget>
 
 class CentralWidget;
 class Tab;
+class WebTab;
 
 class BrowserWindow : public QMainWindow
 {
@@ -17,8 +21,15 @@ class BrowserWindow : public QMainWindow
 public:
     explicit BrowserWindow(QWidget *parent = nullptr);
     Tab *add_new_tab();
+    Tab *open_new_tab();
     Tab *add_existing_tab(Tab *tab);
+    WebTab *add_background_tab(const QUrl &url, const QString &title = QString(), const QIcon &icon = QIcon());
+    void remove_tab(int index);
+    int current_index() const;
+    void set_current_index(int index);
     QList<Tab *> tabs() const;
+    QSet<qint64> suspend_background_tabs(QWebEnginePage::LifecycleState state);
+    bool suspend_tab(WebTab *tab, QWebEnginePage::LifecycleState state);
 
     void closeEvent(QCloseEvent *event);
 };
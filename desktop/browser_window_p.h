@@ -1,29 +1,41 @@
 #pragma once
 
+#include <QSet>
 #include <QStackedWidget>
 #include <QTabBar>
 #include <QToolButton>
+#include <QUrl>
+#include <QWebEnginePage>
 
 class Tab;
+class WebTab;
 class NormalTabbar;
+class TabLifecycle;
 
 class CentralWidget : public QWidget
 {
     QStackedWidget *m_stacked_widget = nullptr;
     NormalTabbar *m_tabbar = nullptr;
+    TabLifecycle *m_lifecycle = nullptr;
 
     void setup_tabbar();
     void showNormalTabbarContextMenu(const QPoint &pos);
+    void insert_tab(Tab *tab);
 
 public:
     explicit CentralWidget(QWidget *parent = nullptr);
 
     Tab *add_new_tab();
+    Tab *open_new_tab();
     Tab *add_existing_tab(Tab *tab);
+    WebTab *add_background_tab(const QUrl &url, const QString &title = QString(), const QIcon &icon = QIcon());
     void remove_tab(int index);
     int current_index() const;
+    void set_current_index(int index);
     Tab *current_tab() const;
     QList<Tab *> tabs() const;
+    QSet<qint64> suspend_background_tabs(QWebEnginePage::LifecycleState state);
+    bool suspend_tab(WebTab *tab, QWebEnginePage::LifecycleState state);
 };
 
 class NormalTabbar : public QTabBar
@@ -0,0 +1,784 @@
+#include "bookmarks.h"
+#include "completion.h"
+#include "database.h"
+#include "history.h"
+
+#include <QSqlQuery>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <queue>
+
+const int BLOCK_SIZE = 16;
+const int DELTA_LIMIT = 4096;
+const int MIN_REMOVED_FOR_REBUILD = 1024;
+const int MAX_TITLE_WORDS = 8;
+
+// Frecency decays exponentially, so scores are kept as log(sum(exp(rate * visit time)))
+// which orders entries the same way at any later time and never has to be recomputed.
+const double HALF_LIFE = 30 * 24 * 60 * 60;
+const qint64 SCORE_EPOCH = Q_INT64_C(1577836800);
+const double NO_SCORE = -std::numeric_limits<double>::infinity();
+const double BOOKMARK_BONUS = std::log(4.0);
+const double UNVISITED_PENALTY = std::log(8.0);
+
+static double visit_score(const QDateTime &time)
+{
+    return std::log(2.0) * (time.toSecsSinceEpoch() - SCORE_EPOCH) / HALF_LIFE;
+}
+
+static double add_scores(double a, double b)
+{
+    if (a == NO_SCORE)
+        return b;
+    if (b == NO_SCORE)
+        return a;
+
+    const double high = qMax(a, b);
+    return high + std::log1p(std::exp(qMin(a, b) - high));
+}
+
+static quint16 address_start(const QString &address)
+{
+    int start = 0;
+    const int scheme = address.indexOf(QStringLiteral("://"));
+    if (scheme > 0 && scheme < 16)
+        start = scheme + 3;
+    if (address.midRef(start).startsWith(QStringLiteral("www.")))
+        start += 4;
+    return quint16(start);
+}
+
+static quint64 pack_prefix(const QStringRef &text)
+{
+    // the first four code units packed big-endian compare like the strings themselves
+    quint64 prefix = 0;
+    for (int i = 0; i < 4; i++) {
+        prefix = (prefix << 16) | (i < text.length() ? text.at(i).unicode() : 0);
+    }
+    return prefix;
+}
+
+static double unvisited_score()
+{
+    return visit_score(QDateTime::currentDateTime()) - UNVISITED_PENALTY;
+}
+
+static CompletionIndex::Entry make_entry(const QString &address, const QString &title, double created)
+{
+    CompletionIndex::Entry entry;
+    entry.address = address;
+    entry.title = title;
+    entry.match_address = address.toLower();
+    entry.match_title = title.toLower();
+    entry.visits = NO_SCORE;
+    entry.created = created;
+    entry.address_start = address_start(entry.match_address);
+    return entry;
+}
+
+struct Candidate
+{
+    enum Kind {
+        Node,
+        Key,
+        DeltaKey,
+    };
+
+    float score;
+    Kind kind;
+    int index;
+
+    bool operator<(const Candidate &other) const {
+        return score < other.score;
+    }
+};
+
+CompletionIndex::CompletionIndex()
+{
+    m_title_table.is_title = true;
+}
+
+void CompletionIndex::build(const QVector<CompletionSource> &sources)
+{
+    clear();
+    m_entries.reserve(sources.count());
+    const double created = unvisited_score();
+
+    for (const CompletionSource &source : sources) {
+        if (source.address.isEmpty())
+            continue;
+
+        auto it = m_addresses.constFind(source.address);
+        if (it == m_addresses.constEnd()) {
+            it = m_addresses.insert(source.address, m_entries.count());
+            m_entries.append(make_entry(source.address, source.title, created));
+        }
+
+        Entry &entry = m_entries[it.value()];
+        entry.is_bookmark |= source.is_bookmark;
+        if (source.visit_count > 0 && source.last_visited.isValid())
+            entry.visits = add_scores(entry.visits, visit_score(source.last_visited) + std::log(double(source.visit_count)));
+    }
+
+    rebuild();
+}
+
+void CompletionIndex::clear()
+{
+    m_entries.clear();
+    m_addresses.clear();
+    m_address_table = Table();
+    m_title_table = Table();
+    m_title_table.is_title = true;
+    m_first_unindexed = 0;
+    m_removed_count = 0;
+}
+
+void CompletionIndex::add_visit(const QString &address, const QString &title, const QDateTime &visited)
+{
+    set_title(address, title);
+
+    auto it = m_addresses.constFind(address);
+    const quint32 id = it == m_addresses.constEnd() ? add_entry(address, title) : it.value();
+
+    m_entries[id].visits = add_scores(m_entries.at(id).visits, visit_score(visited));
+    update_score(id);
+}
+
+void CompletionIndex::set_title(const QString &address, const QString &title)
+{
+    auto it = m_addresses.constFind(address);
+    if (it == m_addresses.constEnd() || title.isEmpty() || m_entries.at(it.value()).title == title)
+        return;
+
+    // the title words are part of the keys, so a renamed entry is indexed again
+    const Entry previous = m_entries.at(it.value());
+    remove_entry(it.value());
+    const quint32 id = add_entry(address, title);
+    m_entries[id].visits = previous.visits;
+    m_entries[id].created = previous.created;
+    m_entries[id].is_bookmark = previous.is_bookmark;
+    update_score(id);
+}
+
+void CompletionIndex::set_bookmarked(const QString &address, const QString &title, bool is_bookmark)
+{
+    auto it = m_addresses.constFind(address);
+    if (it == m_addresses.constEnd()) {
+        if (is_bookmark)
+            m_entries[add_entry(address, title)].is_bookmark = true;
+        return;
+    }
+
+    const quint32 id = it.value();
+    m_entries[id].is_bookmark = is_bookmark;
+    if (!is_bookmark && m_entries.at(id).visits == NO_SCORE)
+        remove_entry(id);
+    else
+        update_score(id);
+}
+
+void CompletionIndex::remove(const QString &address)
+{
+    auto it = m_addresses.constFind(address);
+    if (it == m_addresses.constEnd())
+        return;
+
+    const quint32 id = it.value();
+    if (m_entries.at(id).is_bookmark) {
+        m_entries[id].visits = NO_SCORE;
+        update_score(id);
+    } else {
+        remove_entry(id);
+    }
+}
+
+QVector<Completion> CompletionIndex::complete(const QString &text, int limit) const
+{
+    QVector<Completion> completions;
+    const QString query = text.trimmed().toLower();
+    if (query.isEmpty())
+        return completions;
+
+    QVector<quint32> ids = top_entries(m_address_table, query.mid(address_start(query)), limit);
+    for (quint32 id : top_entries(m_title_table, query, limit)) {
+        if (!ids.contains(id))
+            ids.append(id);
+    }
+
+    std::stable_sort(ids.begin(), ids.end(), [this] (quint32 a, quint32 b) {
+        return score(a) > score(b);
+    });
+
+    // a match is only confident if it outweighs the other candidates and a single fresh visit
+    double total = visit_score(QDateTime::currentDateTime());
+    for (quint32 id : qAsConst(ids)) {
+        total = add_scores(total, score(id));
+    }
+
+    for (int i = 0; i < ids.count() && i < limit; i++) {
+        const Entry &entry = m_entries.at(ids.at(i));
+        completions.append(Completion { entry.address, entry.title, entry.is_bookmark, std::exp(score(ids.at(i)) - total) });
+    }
+
+    return completions;
+}
+
+QString CompletionIndex::inline_completion(const QString &text, QString *destination) const
+{
+    if (text.isEmpty() || text.at(text.length() - 1).isSpace())
+        return QString();
+
+    const QString query = text.toLower();
+    const QString stripped = query.mid(address_start(query));
+    if (stripped.isEmpty())
+        return QString();
+
+    const QVector<quint32> ids = top_entries(m_address_table, stripped, 1);
+    if (ids.isEmpty())
+        return QString();
+
+    const Entry &entry = m_entries.at(ids.at(0));
+    const QStringRef match = entry.match_address.midRef(entry.address_start);
+
+    // complete the host first, the rest of the address once a path is being typed
+    int end = match.length();
+    if (!stripped.contains(QLatin1Char('/'))) {
+        const int slash = match.indexOf(QLatin1Char('/'), stripped.length());
+        if (slash != -1)
+            end = slash + 1;
+    }
+
+    const QString &source = entry.address.length() == entry.match_address.length() ? entry.address : entry.match_address;
+    if (destination)
+        *destination = source.left(entry.address_start + end);
+    return source.mid(entry.address_start + stripped.length(), end - stripped.length());
+}
+
+int CompletionIndex::count() const
+{
+    return m_entries.count() - m_removed_count;
+}
+
+quint32 CompletionIndex::add_entry(const QString &address, const QString &title)
+{
+    const quint32 id = m_entries.count();
+    m_entries.append(make_entry(address, title, unvisited_score()));
+    m_addresses.insert(address, id);
+
+    add_keys(id, m_address_table, m_address_table.delta);
+    add_keys(id, m_title_table, m_title_table.delta);
+    if (m_address_table.delta.count() + m_title_table.delta.count() > DELTA_LIMIT)
+        merge_delta();
+
+    return id;
+}
+
+void CompletionIndex::remove_entry(quint32 id)
+{
+    Entry &entry = m_entries[id];
+    entry.is_removed = true;
+    m_addresses.remove(entry.address);
+    m_removed_count++;
+
+    if (m_removed_count > MIN_REMOVED_FOR_REBUILD && m_removed_count > m_entries.count() / 4)
+        rebuild();
+    else
+        update_score(id);
+}
+
+void CompletionIndex::add_keys(quint32 id, const Table &table, QVector<Key> &keys) const
+{
+    const Entry &entry = m_entries.at(id);
+
+    if (!table.is_title) {
+        if (entry.address_start < entry.match_address.length()) {
+            Key key;
+            key.entry = id;
+            key.offset = entry.address_start;
+            key.prefix = pack_prefix(entry.match_address.midRef(key.offset));
+            keys.append(key);
+        }
+        return;
+    }
+
+    const QString &title = entry.match_title;
+    int words = 0;
+    bool is_in_word = false;
+    for (int i = 0; i < title.length() && i <= 0xffff && words < MAX_TITLE_WORDS; i++) {
+        const bool is_word = title.at(i).isLetterOrNumber();
+        if (is_word && !is_in_word) {
+            Key key;
+            key.entry = id;
+            key.offset = quint16(i);
+            key.prefix = pack_prefix(title.midRef(i));
+            keys.append(key);
+            words++;
+        }
+        is_in_word = is_word;
+    }
+}
+
+void CompletionIndex::update_score(quint32 id)
+{
+    // keys still waiting in the delta read the score from the entry when queried
+    if (id >= m_first_unindexed)
+        return;
+
+    for (Table *table : { &m_address_table, &m_title_table }) {
+        QVector<Key> keys;
+        add_keys(id, *table, keys);
+        for (const Key &key : qAsConst(keys)) {
+            const int position = find_key(*table, id, key.offset);
+            if (position != -1)
+                update_tree(*table, position);
+        }
+    }
+}
+
+void CompletionIndex::merge_delta()
+{
+    for (Table *table : { &m_address_table, &m_title_table }) {
+        QVector<Key> delta;
+        delta.reserve(table->delta.count());
+        for (const Key &key : qAsConst(table->delta)) {
+            if (!m_entries.at(key.entry).is_removed)
+                delta.append(key);
+        }
+
+        std::sort(delta.begin(), delta.end(), [this, table] (const Key &a, const Key &b) {
+            return key_less(*table, a, b);
+        });
+
+        // binary search each new key instead of comparing every existing one
+        QVector<Key> keys;
+        keys.reserve(table->keys.count() + delta.count());
+        auto it = table->keys.constBegin();
+        for (const Key &key : qAsConst(delta)) {
+            auto position = std::upper_bound(it, table->keys.constEnd(), key, [this, table] (const Key &a, const Key &b) {
+                return key_less(*table, a, b);
+            });
+            std::copy(it, position, std::back_inserter(keys));
+            keys.append(key);
+            it = position;
+        }
+        std::copy(it, table->keys.constEnd(), std::back_inserter(keys));
+
+        table->keys = keys;
+        table->delta.clear();
+        build_tree(*table);
+    }
+
+    m_first_unindexed = m_entries.count();
+}
+
+void CompletionIndex::rebuild()
+{
+    QVector<Entry> entries;
+    entries.reserve(m_entries.count() - m_removed_count);
+    m_addresses.clear();
+    for (const Entry &entry : qAsConst(m_entries)) {
+        if (entry.is_removed)
+            continue;
+        m_addresses.insert(entry.address, entries.count());
+        entries.append(entry);
+    }
+
+    m_entries = entries;
+    m_removed_count = 0;
+
+    for (Table *table : { &m_address_table, &m_title_table }) {
+        table->keys.clear();
+        table->delta.clear();
+        for (int id = 0; id < m_entries.count(); id++) {
+            add_keys(id, *table, table->keys);
+        }
+
+        std::sort(table->keys.begin(), table->keys.end(), [this, table] (const Key &a, const Key &b) {
+            return key_less(*table, a, b);
+        });
+        build_tree(*table);
+    }
+
+    m_first_unindexed = m_entries.count();
+}
+
+void CompletionIndex::build_tree(Table &table)
+{
+    // a max tree over blocks of keys, so the best matches of a range are found without visiting all of it
+    const int blocks = (table.keys.count() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int size = 1;
+    while (size < blocks) {
+        size <<= 1;
+    }
+
+    table.tree_size = size;
+    table.tree = QVector<float>(2 * size, -std::numeric_limits<float>::infinity());
+
+    for (int block = 0; block < blocks; block++) {
+        float best = -std::numeric_limits<float>::infinity();
+        const int end = qMin((block + 1) * BLOCK_SIZE, table.keys.count());
+        for (int i = block * BLOCK_SIZE; i < end; i++) {
+            best = qMax(best, float(score(table.keys.at(i).entry)));
+        }
+        table.tree[size + block] = best;
+    }
+
+    for (int node = size - 1; node > 0; node--) {
+        table.tree[node] = qMax(table.tree.at(2 * node), table.tree.at(2 * node + 1));
+    }
+}
+
+void CompletionIndex::update_tree(Table &table, int position)
+{
+    const int block = position / BLOCK_SIZE;
+    float best = -std::numeric_limits<float>::infinity();
+    const int end = qMin((block + 1) * BLOCK_SIZE, table.keys.count());
+    for (int i = block * BLOCK_SIZE; i < end; i++) {
+        best = qMax(best, float(score(table.keys.at(i).entry)));
+    }
+
+    int node = table.tree_size + block;
+    table.tree[node] = best;
+    for (node >>= 1; node > 0; node >>= 1) {
+        table.tree[node] = qMax(table.tree.at(2 * node), table.tree.at(2 * node + 1));
+    }
+}
+
+QStringRef CompletionIndex::key_text(const Table &table, const Key &key) const
+{
+    const Entry &entry = m_entries.at(key.entry);
+    return (table.is_title ? entry.match_title : entry.match_address).midRef(key.offset);
+}
+
+double CompletionIndex::score(quint32 id) const
+{
+    const Entry &entry = m_entries.at(id);
+    if (entry.is_removed)
+        return NO_SCORE;
+
+    const double visits = entry.visits == NO_SCORE ? entry.created : entry.visits;
+    return entry.is_bookmark ? visits + BOOKMARK_BONUS : visits;
+}
+
+bool CompletionIndex::key_less(const Table &table, const Key &a, const Key &b) const
+{
+    if (a.prefix != b.prefix)
+        return a.prefix < b.prefix;
+
+    const int result = key_text(table, a).compare(key_text(table, b));
+    if (result != 0)
+        return result < 0;
+
+    return a.entry < b.entry;
+}
+
+int CompletionIndex::find_key(const Table &table, quint32 id, quint16 offset) const
+{
+    Key key;
+    key.entry = id;
+    key.offset = offset;
+    key.prefix = pack_prefix(key_text(table, key));
+
+    auto it = std::lower_bound(table.keys.constBegin(), table.keys.constEnd(), key, [this, &table] (const Key &a, const Key &b) {
+        return key_less(table, a, b);
+    });
+
+    if (it == table.keys.constEnd() || it->entry != id || it->offset != offset)
+        return -1;
+    return it - table.keys.constBegin();
+}
+
+QVector<quint32> CompletionIndex::top_entries(const Table &table, const QString &prefix, int limit) const
+{
+    QVector<quint32> ids;
+    if (prefix.isEmpty() || limit <= 0)
+        return ids;
+
+    const quint64 packed = pack_prefix(QStringRef(&prefix));
+    auto lower = std::lower_bound(table.keys.constBegin(), table.keys.constEnd(), prefix, [this, &table, packed] (const Key &key, const QString &text) {
+        if (key.prefix != packed)
+            return key.prefix < packed;
+        return key_text(table, key).compare(text) < 0;
+    });
+    auto upper = std::partition_point(lower, table.keys.constEnd(), [this, &table, &prefix] (const Key &key) {
+        return key_text(table, key).startsWith(prefix);
+    });
+
+    const int first = lower - table.keys.constBegin();
+    const int last = upper - table.keys.constBegin();
+
+    std::priority_queue<Candidate> candidates;
+    auto push_key = [this, &table, &candidates] (int position) {
+        candidates.push(Candidate { float(score(table.keys.at(position).entry)), Candidate::Key, position });
+    };
+
+    const int first_block = (first + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const int last_block = last / BLOCK_SIZE;
+    if (first_block >= last_block) {
+        for (int i = first; i < last; i++) {
+            push_key(i);
+        }
+    } else {
+        for (int i = first; i < first_block * BLOCK_SIZE; i++) {
+            push_key(i);
+        }
+        for (int i = last_block * BLOCK_SIZE; i < last; i++) {
+            push_key(i);
+        }
+
+        for (int left = first_block + table.tree_size, right = last_block + table.tree_size; left < right; left >>= 1, right >>= 1) {
+            if (left & 1) {
+                candidates.push(Candidate { table.tree.at(left), Candidate::Node, left });
+                left++;
+            }
+            if (right & 1) {
+                right--;
+                candidates.push(Candidate { table.tree.at(right), Candidate::Node, right });
+            }
+        }
+    }
+
+    for (int i = 0; i < table.delta.count(); i++) {
+        const Key &key = table.delta.at(i);
+        if (key_text(table, key).startsWith(prefix))
+            candidates.push(Candidate { float(score(key.entry)), Candidate::DeltaKey, i });
+    }
+
+    while (!candidates.empty() && ids.count() < limit) {
+        const Candidate candidate = candidates.top();
+        candidates.pop();
+
+        if (candidate.score == -std::numeric_limits<float>::infinity())
+            break;
+
+        switch (candidate.kind) {
+        case Candidate::Node:
+            if (candidate.index >= table.tree_size) {
+                const int block = candidate.index - table.tree_size;
+                const int end = qMin((block + 1) * BLOCK_SIZE, table.keys.count());
+                for (int i = block * BLOCK_SIZE; i < end; i++) {
+                    push_key(i);
+                }
+            } else {
+                candidates.push(Candidate { table.tree.at(2 * candidate.index), Candidate::Node, 2 * candidate.index });
+                candidates.push(Candidate { table.tree.at(2 * candidate.index + 1), Candidate::Node, 2 * candidate.index + 1 });
+            }
+            break;
+        case Candidate::Key:
+        case Candidate::DeltaKey: {
+            const quint32 id = candidate.kind == Candidate::Key ? table.keys.at(candidate.index).entry : table.delta.at(candidate.index).entry;
+            if (!ids.contains(id))
+                ids.append(id);
+            break;
+        }
+        }
+    }
+
+    return ids;
+}
+
+static void collect_bookmarks(const BookmarkTreeNode *node, QHash<const BookmarkTreeNode *, QString> &bookmarks)
+{
+    if (node->type == BookmarkTreeNode::Address && !node->address.isEmpty())
+        bookmarks.insert(node, node->address);
+
+    for (const BookmarkTreeNode *child : node->children) {
+        collect_bookmarks(child, bookmarks);
+    }
+}
+
+void Completer::load()
+{
+    m_is_loading = true;
+    m_pending.clear();
+    const int generation = ++m_generation;
+
+    m_bookmarks.clear();
+    m_changed_bookmarks.clear();
+    collect_bookmarks(m_bookmark_model->root_node(), m_bookmarks);
+
+    QVector<CompletionSource> bookmarks;
+    for (auto it = m_bookmarks.constBegin(); it != m_bookmarks.constEnd(); ++it) {
+        CompletionSource source;
+        source.address = it.value();
+        source.title = it.key()->title;
+        source.is_bookmark = true;
+        bookmarks.append(source);
+    }
+
+    m_database->read<CompletionIndex>([bookmarks] (DatabaseWorker *db) {
+        QVector<CompletionSource> sources;
+        db->exec(QStringLiteral("SELECT address, title, visit_count, last_visited FROM history"), QVariantList(), [&sources] (QSqlQuery &query) {
+            while (query.next()) {
+                CompletionSource source;
+                source.address = query.value(0).toString();
+                source.title = query.value(1).toString();
+                source.visit_count = query.value(2).toInt();
+                source.last_visited = query.value(3).toDateTime();
+                sources.append(source);
+            }
+        });
+        sources.append(bookmarks);
+
+        CompletionIndex index;
+        index.build(sources);
+        return index;
+    }, this, [this, generation] (const CompletionIndex &index) {
+        if (generation != m_generation)
+            return;
+
+        m_index = index;
+        m_is_loading = false;
+        for (const auto &change : qAsConst(m_pending)) {
+            change(m_index);
+        }
+        m_pending.clear();
+    });
+}
+
+void Completer::apply(const std::function<void (CompletionIndex &)> &change)
+{
+    if (m_is_loading)
+        m_pending.append(change);
+    else
+        change(m_index);
+}
+
+void Completer::bookmarks_inserted(const QModelIndex &parent, int first, int last)
+{
+    const BookmarkTreeNode *node = parent.isValid() ? m_bookmark_model->tree_node(parent) : m_bookmark_model->root_node();
+    for (int i = first; i <= last; i++) {
+        QHash<const BookmarkTreeNode *, QString> inserted;
+        collect_bookmarks(node->children.at(i), inserted);
+        for (auto it = inserted.constBegin(); it != inserted.constEnd(); ++it) {
+            m_bookmarks.insert(it.key(), it.value());
+            m_changed_bookmarks.insert(it.value());
+        }
+    }
+    m_bookmark_timer->start();
+}
+
+void Completer::bookmarks_removed(const QModelIndex &parent, int first, int last)
+{
+    const BookmarkTreeNode *node = parent.isValid() ? m_bookmark_model->tree_node(parent) : m_bookmark_model->root_node();
+    for (int i = first; i <= last; i++) {
+        QHash<const BookmarkTreeNode *, QString> removed;
+        collect_bookmarks(node->children.at(i), removed);
+        for (auto it = removed.constBegin(); it != removed.constEnd(); ++it) {
+            m_bookmarks.remove(it.key());
+            m_changed_bookmarks.insert(it.value());
+        }
+    }
+    m_bookmark_timer->start();
+}
+
+void Completer::bookmarks_changed(const QModelIndex &top_left, const QModelIndex &bottom_right)
+{
+    for (int row = top_left.row(); row <= bottom_right.row(); row++) {
+        const BookmarkTreeNode *node = m_bookmark_model->tree_node(m_bookmark_model->index(row, 0, top_left.parent()));
+        if (!node)
+            continue;
+
+        // an edited address leaves the old one behind, both are checked again
+        const QString previous = m_bookmarks.take(node);
+        if (!previous.isEmpty())
+            m_changed_bookmarks.insert(previous);
+
+        if (node->type == BookmarkTreeNode::Address && !node->address.isEmpty()) {
+            m_bookmarks.insert(node, node->address);
+            m_changed_bookmarks.insert(node->address);
+        }
+    }
+    m_bookmark_timer->start();
+}
+
+void Completer::bookmarks_reset()
+{
+    for (const QString &address : qAsConst(m_bookmarks)) {
+        m_changed_bookmarks.insert(address);
+    }
+
+    m_bookmarks.clear();
+    collect_bookmarks(m_bookmark_model->root_node(), m_bookmarks);
+    for (const QString &address : qAsConst(m_bookmarks)) {
+        m_changed_bookmarks.insert(address);
+    }
+    m_bookmark_timer->start();
+}
+
+void Completer::sync_bookmarks()
+{
+    // only the addresses touched since the last sync are looked up, through the model's address index
+    for (const QString &address : qAsConst(m_changed_bookmarks)) {
+        const BookmarkTreeNode *bookmark = nullptr;
+        for (const BookmarkTreeNode *node : m_bookmark_model->find_bookmarks(address)) {
+            if (node->address == address) {
+                bookmark = node;
+                break;
+            }
+        }
+
+        const QString title = bookmark ? bookmark->title : QString();
+        const bool is_bookmark = bookmark;
+        apply([address, title, is_bookmark] (CompletionIndex &index) { index.set_bookmarked(address, title, is_bookmark); });
+    }
+
+    m_changed_bookmarks.clear();
+}
+
+Completer::Completer(Database *database, HistoryModel *history_model, BookmarkModel *bookmark_model, QObject *parent)
+    : QObject(parent)
+    , m_database(database)
+    , m_history_model(history_model)
+    , m_bookmark_model(bookmark_model)
+{
+    m_bookmark_timer = new QTimer(this);
+    m_bookmark_timer->setSingleShot(true);
+    m_bookmark_timer->setInterval(0);
+
+    connect(m_bookmark_timer, &QTimer::timeout, this, &Completer::sync_bookmarks);
+
+    connect(m_history_model, &HistoryModel::entry_visited, this, [this] (const HistoryEntry &entry) {
+        const QString address = entry.address;
+        const QString title = entry.title;
+        const QDateTime visited = entry.last_visited;
+        apply([address, title, visited] (CompletionIndex &index) { index.add_visit(address, title, visited); });
+    });
+    connect(m_history_model, &HistoryModel::entry_changed, this, [this] (const HistoryEntry &entry) {
+        const QString address = entry.address;
+        const QString title = entry.title;
+        apply([address, title] (CompletionIndex &index) { index.set_title(address, title); });
+    });
+    connect(m_history_model, &HistoryModel::address_removed, this, [this] (const QString &address) {
+        apply([address] (CompletionIndex &index) { index.remove(address); });
+    });
+    connect(m_history_model, &HistoryModel::entries_expired, this, [this] (const QDateTime &, const QStringList &addresses) {
+        apply([addresses] (CompletionIndex &index) {
+            for (const QString &address : addresses) {
+                index.remove(address);
+            }
+        });
+    });
+    connect(m_history_model, &QAbstractItemModel::modelReset, this, &Completer::load);
+
+    connect(m_bookmark_model, &QAbstractItemModel::rowsInserted, this, &Completer::bookmarks_inserted);
+    connect(m_bookmark_model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &Completer::bookmarks_removed);
+    connect(m_bookmark_model, &QAbstractItemModel::dataChanged, this, &Completer::bookmarks_changed);
+    connect(m_bookmark_model, &QAbstractItemModel::modelReset, this, &Completer::bookmarks_reset);
+
+    load();
+}
+
+QVector<Completion> Completer::complete(const QString &text, int limit) const
+{
+    return m_index.complete(text, limit);
+}
+
+QString Completer::inline_completion(const QString &text, QString *destination) const
+{
+    return m_index.inline_completion(text, destination);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QModelIndex>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+class BookmarkModel;
+class BookmarkTreeNode;
+class Database;
+class HistoryModel;
+
+struct Completion
+{
+    QString address;
+    QString title;
+    bool is_bookmark = false;
+    double confidence = 0;
+};
+
+struct CompletionSource
+{
+    QString address;
+    QString title;
+    int visit_count = 0;
+    QDateTime last_visited;
+    bool is_bookmark = false;
+};
+
+class CompletionIndex
+{
+public:
+    struct Entry
+    {
+        QString address;
+        QString title;
+        QString match_address;
+        QString match_title;
+        double visits = 0;
+        double created = 0;
+        quint16 address_start = 0;
+        bool is_bookmark = false;
+        bool is_removed = false;
+    };
+
+    struct Key
+    {
+        quint64 prefix = 0;
+        quint32 entry = 0;
+        quint16 offset = 0;
+    };
+
+    struct Table
+    {
+        bool is_title = false;
+        QVector<Key> keys;
+        QVector<Key> delta;
+        QVector<float> tree;
+        int tree_size = 0;
+    };
+
+    CompletionIndex();
+
+    void build(const QVector<CompletionSource> &sources);
+    void clear();
+
+    void add_visit(const QString &address, const QString &title, const QDateTime &visited);
+    void set_title(const QString &address, const QString &title);
+    void set_bookmarked(const QString &address, const QString &title, bool is_bookmark);
+    void remove(const QString &address);
+
+    QVector<Completion> complete(const QString &text, int limit) const;
+    QString inline_completion(const QString &text, QString *destination = nullptr) const;
+    int count() const;
+
+private:
+    QVector<Entry> m_entries;
+    QHash<QString, quint32> m_addresses;
+    Table m_address_table;
+    Table m_title_table;
+    quint32 m_first_unindexed = 0;
+    int m_removed_count = 0;
+
+    quint32 add_entry(const QString &address, const QString &title);
+    void remove_entry(quint32 id);
+    void add_keys(quint32 id, const Table &table, QVector<Key> &keys) const;
+    void update_score(quint32 id);
+    void merge_delta();
+    void rebuild();
+    void build_tree(Table &table);
+    void update_tree(Table &table, int position);
+
+    QStringRef key_text(const Table &table, const Key &key) const;
+    double score(quint32 id) const;
+    bool key_less(const Table &table, const Key &a, const Key &b) const;
+    int find_key(const Table &table, quint32 id, quint16 offset) const;
+    QVector<quint32> top_entries(const Table &table, const QString &prefix, int limit) const;
+};
+
+class Completer : public QObject
+{
+    Database *m_database = nullptr;
+    HistoryModel *m_history_model = nullptr;
+    BookmarkModel *m_bookmark_model = nullptr;
+
+    CompletionIndex m_index;
+    bool m_is_loading = false;
+    int m_generation = 0;
+    QVector<std::function<void (CompletionIndex &)>> m_pending;
+
+    QHash<const BookmarkTreeNode *, QString> m_bookmarks;
+    QSet<QString> m_changed_bookmarks;
+    QTimer *m_bookmark_timer = nullptr;
+
+    void load();
+    void apply(const std::function<void (CompletionIndex &)> &change);
+    void bookmarks_inserted(const QModelIndex &parent, int first, int last);
+    void bookmarks_removed(const QModelIndex &parent, int first, int last);
+    void bookmarks_changed(const QModelIndex &top_left, const QModelIndex &bottom_right);
+    void bookmarks_reset();
+    void sync_bookmarks();
+public:
+    explicit Completer(Database *database, HistoryModel *history_model, BookmarkModel *bookmark_model, QObject *parent = nullptr);
+
+    QVector<Completion> complete(const QString &text, int limit) const;
+    QString inline_completion(const QString &text, QString *destination = nullptr) const;
+};
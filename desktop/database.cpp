@@ -0,0 +1,261 @@
+#include "database.h"
+
+#include <QDebug>
+#include <QSqlError>
+
+const QString CONNECTION_NAME = QStringLiteral("crusta");
+
+void DatabaseWorker::migrate()
+{
+    // Each entry upgrades the schema by one version, never edit an entry once it has shipped.
+    const QVector<QStringList> migrations {
+        {
+            QStringLiteral("CREATE TABLE IF NOT EXISTS history (title TEXT, address TEXT UNIQUE, icon BLOB, last_visited DATETIME)"),
+            QStringLiteral("CREATE INDEX IF NOT EXISTS history_last_visited ON history (last_visited)"),
+        },
+        {
+            QStringLiteral("CREATE TABLE IF NOT EXISTS history_content (address TEXT UNIQUE, title TEXT, content BLOB, visited DATETIME)"),
+            QStringLiteral("CREATE INDEX IF NOT EXISTS history_content_visited ON history_content (visited)"),
+            QStringLiteral("CREATE VIRTUAL TABLE IF NOT EXISTS history_fts USING fts5(title, content, content='')"),
+        },
+        {
+            QStringLiteral("ALTER TABLE history ADD COLUMN visit_count INTEGER NOT NULL DEFAULT 1"),
+        },
+        {
+            // history_fts is keyed on history_content rows, an implicit rowid may be renumbered by VACUUM
+            QStringLiteral("CREATE TABLE history_content_keyed (id INTEGER PRIMARY KEY, address TEXT UNIQUE, title TEXT, content BLOB, visited DATETIME)"),
+            QStringLiteral("INSERT INTO history_content_keyed (id, address, title, content, visited) "
+                           "SELECT rowid, address, title, content, visited FROM history_content"),
+            QStringLiteral("DROP TABLE history_content"),
+            QStringLiteral("ALTER TABLE history_content_keyed RENAME TO history_content"),
+            QStringLiteral("CREATE INDEX IF NOT EXISTS history_content_visited ON history_content (visited)"),
+        },
+    };
+
+    QSqlQuery query(m_database);
+    if (!query.exec(QStringLiteral("PRAGMA user_version")) || !query.next()) {
+        qDebug() << query.lastError();
+        return;
+    }
+
+    for (int version = query.value(0).toInt(); version < migrations.count(); version++) {
+        m_database.transaction();
+
+        for (const QString &statement : migrations.at(version)) {
+            if (!query.exec(statement)) {
+                qDebug() << "Database migration" << version + 1 << "failed" << query.lastError();
+                m_database.rollback();
+                return;
+            }
+        }
+
+        if (!query.exec(QStringLiteral("PRAGMA user_version = %1").arg(version + 1))) {
+            qDebug() << query.lastError();
+            m_database.rollback();
+            return;
+        }
+
+        m_database.commit();
+    }
+}
+
+DatabaseWorker::DatabaseWorker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    flush();
+    m_statements.clear();
+
+    if (m_database.isOpen())
+        m_database.close();
+
+    m_database = QSqlDatabase();
+    QSqlDatabase::removeDatabase(CONNECTION_NAME);
+}
+
+void DatabaseWorker::open(const QString &path)
+{
+    const QString driver = QStringLiteral("QSQLITE");
+    if (!QSqlDatabase::isDriverAvailable(driver)) {
+        qDebug() << "Driver not available";
+        return;
+    }
+
+    m_database = QSqlDatabase::addDatabase(driver, CONNECTION_NAME);
+    m_database.setDatabaseName(path);
+    if (!m_database.open()) {
+        qDebug() << m_database.lastError();
+        return;
+    }
+
+    QSqlQuery query(m_database);
+    // free on a new file; existing profiles are converted by HistoryRetention
+    if (m_database.tables().isEmpty() && !query.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL")))
+        qDebug() << query.lastError();
+
+    if (!query.exec(QStringLiteral("PRAGMA journal_mode = WAL"))
+            || !query.exec(QStringLiteral("PRAGMA synchronous = NORMAL"))) {
+        qDebug() << query.lastError();
+    }
+
+    migrate();
+
+    // history imports used to drop this index while they ran, restore it if a crash left it missing
+    if (m_database.tables().contains(QStringLiteral("history"))
+            && !query.exec(QStringLiteral("CREATE INDEX IF NOT EXISTS history_last_visited ON history (last_visited)"))) {
+        qDebug() << query.lastError();
+    }
+
+    m_tables = m_database.tables();
+}
+
+void DatabaseWorker::queue_write(const QString &sql, const QVariantList &values)
+{
+    m_writes.append(Write { sql, values });
+    if (m_is_flush_queued)
+        return;
+
+    m_is_flush_queued = true;
+    QMetaObject::invokeMethod(this, [this] { flush(); }, Qt::QueuedConnection);
+}
+
+void DatabaseWorker::flush()
+{
+    m_is_flush_queued = false;
+    if (m_writes.isEmpty())
+        return;
+
+    m_database.transaction();
+    for (const Write &write : qAsConst(m_writes)) {
+        exec(write.sql, write.values);
+    }
+    m_database.commit();
+
+    m_writes.clear();
+}
+
+bool DatabaseWorker::statement(const QString &sql, QSqlQuery *query)
+{
+    if (!m_database.isOpen())
+        return false;
+
+    auto it = m_statements.find(sql);
+    if (it == m_statements.end()) {
+        QSqlQuery prepared(m_database);
+        if (!prepared.prepare(sql)) {
+            qDebug() << prepared.lastError() << sql;
+            return false;
+        }
+        it = m_statements.insert(sql, prepared);
+    }
+
+    *query = it.value();
+    return true;
+}
+
+bool DatabaseWorker::exec(const QString &sql, const QVariantList &values, const std::function<void (QSqlQuery &)> &rows)
+{
+    QSqlQuery query;
+    if (!statement(sql, &query))
+        return false;
+
+    for (int i = 0; i < values.count(); i++) {
+        query.bindValue(i, values.at(i));
+    }
+
+    if (!query.exec()) {
+        qDebug() << query.lastError() << sql;
+        return false;
+    }
+
+    if (rows)
+        rows(query);
+
+    query.finish();
+    return true;
+}
+
+bool DatabaseWorker::exec_batch(const QString &sql, const QVector<QVariantList> &columns)
+{
+    QSqlQuery query;
+    if (!statement(sql, &query))
+        return false;
+
+    for (int i = 0; i < columns.count(); i++) {
+        query.bindValue(i, columns.at(i));
+    }
+
+    if (!query.execBatch()) {
+        qDebug() << query.lastError() << sql;
+        return false;
+    }
+
+    query.finish();
+    return true;
+}
+
+bool DatabaseWorker::transaction()
+{
+    return m_database.transaction();
+}
+
+bool DatabaseWorker::commit()
+{
+    return m_database.commit();
+}
+
+bool DatabaseWorker::rollback()
+{
+    return m_database.rollback();
+}
+
+bool DatabaseWorker::has_table(const QString &name) const
+{
+    return m_tables.contains(name);
+}
+
+Database::Database(const QString &path, QObject *parent)
+    : QObject(parent)
+{
+    m_thread = new QThread(this);
+    m_thread->setObjectName(QStringLiteral("Database"));
+
+    m_worker = new DatabaseWorker;
+    m_worker->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread->start();
+
+    DatabaseWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, path] { worker->open(path); });
+}
+
+Database::~Database()
+{
+    wait();
+    m_thread->quit();
+    m_thread->wait();
+}
+
+void Database::write(const QString &sql, const QVariantList &values)
+{
+    DatabaseWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, sql, values] { worker->queue_write(sql, values); });
+}
+
+void Database::run(const std::function<void (DatabaseWorker *)> &job)
+{
+    DatabaseWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker, job] {
+        worker->flush();
+        job(worker);
+    });
+}
+
+void Database::wait()
+{
+    DatabaseWorker *worker = m_worker;
+    QMetaObject::invokeMethod(m_worker, [worker] { worker->flush(); }, Qt::BlockingQueuedConnection);
+}
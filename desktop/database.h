@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QThread>
+#include <QVariantList>
+#include <QVector>
+
+#include <functional>
+
+class DatabaseWorker : public QObject
+{
+    struct Write
+    {
+        QString sql;
+        QVariantList values;
+    };
+
+    QSqlDatabase m_database;
+    QHash<QString, QSqlQuery> m_statements;
+    QStringList m_tables;
+    QVector<Write> m_writes;
+    bool m_is_flush_queued = false;
+
+    void migrate();
+    bool statement(const QString &sql, QSqlQuery *query);
+public:
+    explicit DatabaseWorker(QObject *parent = nullptr);
+    ~DatabaseWorker();
+
+    void open(const QString &path);
+    void queue_write(const QString &sql, const QVariantList &values);
+    void flush();
+
+    bool exec(const QString &sql, const QVariantList &values = QVariantList(), const std::function<void (QSqlQuery &)> &rows = nullptr);
+    bool exec_batch(const QString &sql, const QVector<QVariantList> &columns);
+    bool transaction();
+    bool commit();
+    bool rollback();
+    bool has_table(const QString &name) const;
+};
+
+class Database : public QObject
+{
+    QThread *m_thread = nullptr;
+    DatabaseWorker *m_worker = nullptr;
+public:
+    explicit Database(const QString &path, QObject *parent = nullptr);
+    ~Database();
+
+    void write(const QString &sql, const QVariantList &values = QVariantList());
+    void run(const std::function<void (DatabaseWorker *)> &job);
+    void wait();
+
+    template <typename T>
+    void read(const std::function<T (DatabaseWorker *)> &job, QObject *context, const std::function<void (const T &)> &callback)
+    {
+        DatabaseWorker *worker = m_worker;
+        QPointer<QObject> receiver(context);
+        QMetaObject::invokeMethod(m_worker, [worker, job, receiver, callback] {
+            worker->flush();
+            const T result = job(worker);
+            if (QObject *object = receiver.data()) {
+                QMetaObject::invokeMethod(object, [callback, result] { callback(result); });
+            }
+        });
+    }
+};
@@ -1,39 +1,69 @@
 #include "browser.h"
 #include "browser_window.h"
+#include "database.h"
 #include "history.h"
+#include "history_index.h"
+#include "history_tree.h"
+#include "memory_pressure.h"
 #include "tab.h"
 #include "webview.h"
 
 #include <QBuffer>
 #include <QDebug>
+#include <QImage>
 #include <QMenu>
-#include <QSqlError>
+#include <QPixmap>
+#include <QSet>
 #include <QSqlQuery>
 #include <QStyleFactory>
 #include <QVBoxLayout>
 
+#include <algorithm>
+
+const int FETCH_LIMIT = 500;
+const int MAX_CACHED_ICONS = 1000;
+
+static QByteArray icon_data(const QIcon &icon)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    icon.pixmap(16, 16).save(&buffer, "PNG");
+    return data;
+}
+
+// pages are keyed on (last_visited, rowid) so visits sharing a timestamp are never skipped
+QVector<StoredHistoryEntry> load_history(DatabaseWorker *db, const QDateTime &start, const QVariant &end, qint64 end_rowid, int limit)
+{
+    QVector<StoredHistoryEntry> entries;
+    db->exec(QStringLiteral("SELECT title, address, last_visited, rowid FROM history "
+                            "WHERE last_visited >= ? AND (last_visited < ? OR (last_visited = ? AND rowid < ?)) "
+                            "ORDER BY last_visited DESC, rowid DESC LIMIT ?"),
+             QVariantList { start, end, end, end_rowid, limit }, [&entries] (QSqlQuery &query) {
+        while (query.next()) {
+            StoredHistoryEntry entry;
+            entry.title = query.value(0).toString();
+            entry.address = query.value(1).toString();
+            entry.visited_key = query.value(2);
+            entry.last_visited = entry.visited_key.toDateTime();
+            entry.rowid = query.value(3).toLongLong();
+            entries.append(entry);
+        }
+    });
+    return entries;
+}
+
 HistoryModel::HistoryModel(QObject *parent)
     : QAbstractTableModel(parent)
 {
-    QSqlQuery query;
-    query.prepare(QStringLiteral("SELECT * FROM history ORDER BY last_visited DESC"));
-    if (!query.exec()) {
-        qDebug() << query.lastError();
-        return;
-    }
+    m_icons.setMaxCost(MAX_CACHED_ICONS);
 
-    while (query.next()) {
-        HistoryEntry entry;
-        entry.title = query.value(QStringLiteral("title")).toString();
-        entry.address = query.value(QStringLiteral("address")).toString();
-        entry.last_visited = query.value(QStringLiteral("last_visited")).toDateTime();
-        QByteArray out_byte_array = query.value(QStringLiteral("icon")).toByteArray();
-        QPixmap out_pixmap = QPixmap();
-        out_pixmap.loadFromData(out_byte_array);
-        entry.icon = QIcon(out_pixmap);
-
-        m_entries.append(entry);
-    }
+    connect(this, &HistoryModel::icon_loaded, this, [this] (const QString &address) {
+        for (int i = 0; i < m_entries.count(); i++) {
+            if (m_entries.at(i).address == address)
+                emit dataChanged(index(i, 0), index(i, 0), QVector<int> { Qt::DecorationRole });
+        }
+    });
 }
 
 int HistoryModel::rowCount(const QModelIndex &parent) const
@@ -64,7 +94,7 @@ QVariant HistoryModel::data(const QModelIndex &index, int role) const
         }
     case Qt::DecorationRole:
         if (index.column() == 0)
-            return entry.icon;
+            return icon(entry.address);
         break;
     }
 
@@ -83,13 +113,120 @@ QVariant HistoryModel::headerData(int section, Qt::Orientation orientation, int
     return QAbstractTableModel::headerData(section, orientation, role);
 }
 
+bool HistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_is_complete && !m_is_fetching;
+}
+
+void HistoryModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    m_is_fetching = true;
+
+    // the first page has no cursor yet and starts past anything that can be stored
+    const QVariant end = m_cursor_visited.isValid() ? m_cursor_visited : QVariant(QDateTime(QDate(9999, 12, 31), QTime(0, 0)));
+    const qint64 end_rowid = m_cursor_rowid;
+    const int generation = m_generation;
+
+    browser->database()->read<QVector<StoredHistoryEntry>>([end, end_rowid] (DatabaseWorker *db) {
+        return load_history(db, QDateTime(QDate(1, 1, 1), QTime(0, 0)), end, end_rowid, FETCH_LIMIT);
+    }, this, [this, generation] (const QVector<StoredHistoryEntry> &stored_entries) {
+        if (generation != m_generation)
+            return;
+
+        m_is_fetching = false;
+        m_is_complete = stored_entries.count() < FETCH_LIMIT;
+        if (stored_entries.isEmpty())
+            return;
+
+        m_cursor_visited = stored_entries.last().visited_key;
+        m_cursor_rowid = stored_entries.last().rowid;
+
+        // a revisit while the page was read is already at the top
+        QSet<QString> addresses;
+        for (const HistoryEntry &entry : qAsConst(m_entries)) {
+            addresses.insert(entry.address);
+        }
+
+        QVector<HistoryEntry> entries;
+        for (const StoredHistoryEntry &stored_entry : stored_entries) {
+            if (addresses.contains(stored_entry.address))
+                continue;
+
+            HistoryEntry entry;
+            entry.title = stored_entry.title;
+            entry.address = stored_entry.address;
+            entry.last_visited = stored_entry.last_visited;
+            entries.append(entry);
+        }
+
+        if (entries.isEmpty())
+            return;
+
+        beginInsertRows(QModelIndex(), m_entries.count(), m_entries.count() + entries.count() - 1);
+        m_entries.append(entries);
+        endInsertRows();
+    });
+}
+
+const HistoryEntry &HistoryModel::entry(int row) const
+{
+    return m_entries.at(row);
+}
+
+QIcon HistoryModel::icon(const QString &address) const
+{
+    if (const QIcon *icon = m_icons.object(address))
+        return *icon;
+
+    if (m_icon_requests.contains(address))
+        return QIcon();
+
+    // icons are read one at a time as rows are painted, a page of history never loads them up front
+    m_icon_requests.insert(address);
+    HistoryModel *model = const_cast<HistoryModel *>(this);
+    browser->database()->read<QImage>([address] (DatabaseWorker *db) {
+        QImage image;
+        db->exec(QStringLiteral("SELECT icon FROM history WHERE address = ?"), QVariantList { address }, [&image] (QSqlQuery &query) {
+            if (query.next())
+                image = QImage::fromData(query.value(0).toByteArray());
+        });
+        return image;
+    }, model, [model, address] (const QImage &image) {
+        if (!model->m_icon_requests.remove(address))
+            return;
+
+        model->m_icons.insert(address, new QIcon(QPixmap::fromImage(image)));
+        emit model->icon_loaded(address);
+    });
+
+    return QIcon();
+}
+
+void HistoryModel::reload()
+{
+    beginResetModel();
+    m_entries.clear();
+    m_cursor_visited = QVariant();
+    m_cursor_rowid = 0;
+    m_is_complete = false;
+    m_is_fetching = false;
+    m_generation++;
+    m_icons.clear();
+    m_icon_requests.clear();
+    endResetModel();
+}
+
 void HistoryModel::add_entry(const HistoryEntry &entry)
 {
     for (int i = 0; i < m_entries.count(); i++) {
         if (m_entries[i].address == entry.address) {
-            remove_entry(i);
-            add_entry(entry);
-            return;
+            beginRemoveRows(QModelIndex(), i, i);
+            m_entries.remove(i);
+            endRemoveRows();
+            break;
         }
     }
 
@@ -97,95 +234,161 @@ void HistoryModel::add_entry(const HistoryEntry &entry)
         return;
     }
 
-    QByteArray in_byte_array;
-    QBuffer in_buffer( &in_byte_array );
-    in_buffer.open( QIODevice::WriteOnly );
-    entry.icon.pixmap(16, 16).save( &in_buffer, "PNG" );
+    browser->database()->write(QStringLiteral("INSERT INTO history (title, address, icon, last_visited) VALUES (?, ?, ?, ?) "
+                                              "ON CONFLICT (address) DO UPDATE SET title = excluded.title, icon = excluded.icon, "
+                                              "last_visited = excluded.last_visited, visit_count = history.visit_count + 1"),
+                               QVariantList { entry.title, entry.address, icon_data(entry.icon), entry.last_visited });
 
-    QSqlQuery query;
-    query.prepare(QStringLiteral("REPLACE INTO history (title, address, icon, last_visited) VALUES (?, ?, ?, ?)"));
-    query.addBindValue(entry.title);
-    query.addBindValue(entry.address);
-    query.addBindValue(in_byte_array);
-    query.addBindValue(entry.last_visited);
-
-    if (!query.exec()) {
-        qDebug() << query.lastError();
-        return;
-    }
+    m_icon_requests.remove(entry.address);
+    m_icons.insert(entry.address, new QIcon(entry.icon));
 
     beginInsertRows(QModelIndex(), 0, 0);
     m_entries.prepend(entry);
     endInsertRows();
+
+    emit entry_visited(entry);
 }
 
-void HistoryModel::remove_entry(int offset)
+void HistoryModel::update_entry(const HistoryEntry &entry)
 {
-    const QString address = m_entries.at(offset).address;
+    // the visit itself is recorded once the page has loaded, until then there is nothing to update
+    for (int i = 0; i < m_entries.count(); i++) {
+        if (m_entries.at(i).address != entry.address)
+            continue;
+
+        m_entries[i].title = entry.title;
+        m_entries[i].icon = entry.icon;
+
+        browser->database()->write(QStringLiteral("UPDATE history SET title = ?, icon = ? WHERE address = ?"),
+                                   QVariantList { entry.title, icon_data(entry.icon), entry.address });
 
-    QSqlQuery query;
-    query.prepare(QStringLiteral("DELETE FROM history WHERE address = ?"));
-    query.addBindValue(address);
+        m_icon_requests.remove(entry.address);
+        m_icons.insert(entry.address, new QIcon(entry.icon));
 
-    if (!query.exec()) {
-        qDebug() << query.lastError();
+        emit dataChanged(index(i, 0), index(i, columnCount(QModelIndex()) - 1));
+        emit entry_changed(m_entries.at(i));
         return;
     }
+}
+
+void HistoryModel::remove_entry(int offset)
+{
+    if (offset < 0 || offset >= m_entries.count())
+        return;
+
+    remove_address(m_entries.at(offset).address);
+}
+
+void HistoryModel::remove_address(const QString &address)
+{
+    browser->database()->write(QStringLiteral("DELETE FROM history WHERE address = ?"), QVariantList { address });
+
+    if (browser->history_indexer())
+        browser->history_indexer()->remove_address(address);
 
-    QMutableVectorIterator<HistoryEntry> it(m_entries);
-    while (it.hasNext()) {
-        HistoryEntry entry = it.next();
-        if (entry.address == address) {
-            int index = m_entries.indexOf(entry);
-            beginRemoveRows(QModelIndex(), index, index);
-            it.remove();
+    m_icons.remove(address);
+
+    for (int i = 0; i < m_entries.count(); i++) {
+        if (m_entries.at(i).address == address) {
+            beginRemoveRows(QModelIndex(), i, i);
+            m_entries.remove(i);
             endRemoveRows();
+            break;
         }
     }
+
+    emit address_removed(address);
 }
 
 void HistoryModel::remove_entries_by_date(const QDateTime &time)
 {
-    QSqlQuery query;
-    query.prepare(QStringLiteral("DELETE FROM history WHERE last_visited > ?"));
-    query.addBindValue(time);
+    browser->database()->write(QStringLiteral("DELETE FROM history WHERE last_visited > ?"), QVariantList { time });
 
-    if (!query.exec()) {
-        qDebug() << query.lastError();
-        return;
+    if (browser->history_indexer())
+        browser->history_indexer()->remove_since(time);
+
+    // listeners rebuild from the database, which no longer has the removed visits
+    reload();
+}
+
+void HistoryModel::expire_entries(const QDateTime &cutoff, const QStringList &addresses)
+{
+    for (const QString &address : addresses) {
+        m_icons.remove(address);
     }
 
-    QMutableVectorIterator<HistoryEntry> it(m_entries);
-    while (it.hasNext()) {
-        HistoryEntry entry = it.next();
-        if (entry.last_visited > time) {
-            int index = m_entries.indexOf(entry);
-            beginRemoveRows(QModelIndex(), index, index);
-            it.remove();
-            endRemoveRows();
-        }
+    // fetched pages are ordered by last_visited descending, so the expired entries form a suffix
+    auto begin = std::partition_point(m_entries.begin(), m_entries.end(), [&cutoff] (const HistoryEntry &entry) {
+        return entry.last_visited > cutoff;
+    });
+
+    const int first = begin - m_entries.begin();
+    const int count = m_entries.count() - first;
+    if (count > 0) {
+        beginRemoveRows(QModelIndex(), first, m_entries.count() - 1);
+        m_entries.remove(first, count);
+        endRemoveRows();
     }
+
+    emit entries_expired(cutoff, addresses);
 }
 
 void HistoryModel::remove_all()
 {
-    QSqlQuery query;
-    query.prepare(QStringLiteral("DELETE FROM history"));
+    browser->database()->write(QStringLiteral("DELETE FROM history"));
+
+    if (browser->history_indexer())
+        browser->history_indexer()->remove_all();
+
+    reload();
+}
+
+void HistoryWidget::setup_search()
+{
+    m_search_bar = new QLineEdit;
+    m_search_bar->setPlaceholderText(QStringLiteral("Search page contents"));
+    m_search_bar->setClearButtonEnabled(true);
+
+    m_search_model = new ContentSearchModel(this);
+    m_search_view = new QTreeView;
+    m_search_view->setModel(m_search_model);
+    m_search_view->setRootIsDecorated(false);
+    m_search_view->hide();
+
+    m_search_timer = new QTimer(this);
+    m_search_timer->setSingleShot(true);
+    m_search_timer->setInterval(250);
+
+    connect(m_search_bar, &QLineEdit::textChanged, m_search_timer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_search_timer, &QTimer::timeout, this, &HistoryWidget::search);
+    connect(m_search_view, &QTreeView::doubleClicked, this, &HistoryWidget::open_in_new_tab);
+}
 
-    if (!query.exec()) {
-        qDebug() << query.lastError();
+void HistoryWidget::search()
+{
+    const QString text = m_search_bar->text().trimmed();
+    if (text.isEmpty()) {
+        m_search_view->hide();
+        m_tree_view->show();
+        m_search_model->set_matches(QVector<ContentMatch>());
         return;
     }
 
-    beginRemoveRows(QModelIndex(), 0, m_entries.count() - 1);
-    m_entries.clear();
-    endRemoveRows();
+    browser->history_indexer()->search(text, this, [this, text] (const QVector<ContentMatch> &matches) {
+        if (m_search_bar->text().trimmed() != text)
+            return;
+
+        m_search_model->set_matches(matches);
+        m_tree_view->hide();
+        m_search_view->show();
+    });
 }
 
 void HistoryWidget::show_context_menu(const QPoint &pos)
 {
     QModelIndex index = m_tree_view->indexAt(pos);
-    if (!index.isValid()) {
+    const QString address = index.data(HistoryModel::AddressRole).toString();
+    if (address.isEmpty()) {
         return;
     }
 
@@ -199,17 +402,16 @@ void HistoryWidget::show_context_menu(const QPoint &pos)
         open_in_new_tab(index);
     });
 
-    connect(open_in_window, &QAction::triggered,[this, index] {
+    connect(open_in_window, &QAction::triggered,[address] {
         BrowserWindow *window = browser->create_browser_window();
         WebTab *tab = dynamic_cast<WebTab *>(window->tabs().at(0));
         if (!tab) return ;
 
-        const QString address = m_tree_view->model()->data(index, HistoryModel::AddressRole).toString();
         tab->webview()->load(address);
     });
 
-    connect(remove_entry, &QAction::triggered, [index] {
-        browser->history_model()->remove_entry(index.row());
+    connect(remove_entry, &QAction::triggered, [address] {
+        browser->history_model()->remove_address(address);
     });
 
 #ifdef Q_OS_MACOS
@@ -220,6 +422,10 @@ void HistoryWidget::show_context_menu(const QPoint &pos)
 
 void HistoryWidget::open_in_new_tab(const QModelIndex &index)
 {
+    const QString address = index.data(HistoryModel::AddressRole).toString();
+    if (address.isEmpty())
+        return;
+
     QWidget *parent_widget = this;
     while (parent_widget->parentWidget()) {
         parent_widget = parent_widget->parentWidget();
@@ -231,19 +437,32 @@ void HistoryWidget::open_in_new_tab(const QModelIndex &index)
     WebTab *tab = dynamic_cast<WebTab *>(window->add_new_tab());
     if (!tab) return;
 
-    const QString address = m_tree_view->model()->data(index, HistoryModel::AddressRole).toString();
     tab->webview()->load(address);
 }
 
 HistoryWidget::HistoryWidget(QWidget *parent)
     : QWidget(parent)
 {
+    HistoryTreeModel *tree_model = new HistoryTreeModel(browser->database(), browser->history_model(), this);
+    // only the expanded pages are dropped, they are fetched again when their bucket is expanded
+    browser->memory_pressure()->add_responder(MemoryPressureMonitor::TrimModels, QStringLiteral("history pages"), tree_model, [tree_model] {
+        tree_model->trim();
+        return -1;
+    });
+
     m_tree_view = new QTreeView;
-    m_tree_view->setModel(browser->history_model());
+    m_tree_view->setModel(tree_model);
 
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->setContentsMargins(0, 0, 0, 0);
     setLayout(vbox);
+
+    if (browser->history_indexer()) {
+        setup_search();
+        vbox->addWidget(m_search_bar);
+        vbox->addWidget(m_search_view);
+    }
+
     vbox->addWidget(m_tree_view);
 
     m_tree_view->setContextMenuPolicy(Qt::CustomContextMenu);
@@ -1,12 +1,20 @@
 #pragma once
 
 #include <QAbstractTableModel>
+#include <QCache>
 #include <QDateTime>
 #include <QIcon>
+#include <QLineEdit>
 #include <QModelIndex>
+#include <QSet>
+#include <QTimer>
 #include <QTreeView>
+#include <QVariant>
 #include <QWidget>
 
+class ContentSearchModel;
+class DatabaseWorker;
+
 struct HistoryEntry
 {
     QString title;
@@ -19,9 +27,30 @@ struct HistoryEntry
     }
 };
 
+struct StoredHistoryEntry
+{
+    QString title;
+    QString address;
+    QDateTime last_visited;
+    QVariant visited_key;
+    qint64 rowid = 0;
+};
+
+QVector<StoredHistoryEntry> load_history(DatabaseWorker *db, const QDateTime &start, const QVariant &end, qint64 end_rowid, int limit);
+
 class HistoryModel : public QAbstractTableModel
 {
+    Q_OBJECT
+
     QVector<HistoryEntry> m_entries;
+    QVariant m_cursor_visited;
+    qint64 m_cursor_rowid = 0;
+    bool m_is_complete = false;
+    bool m_is_fetching = false;
+    int m_generation = 0;
+
+    mutable QCache<QString, QIcon> m_icons;
+    mutable QSet<QString> m_icon_requests;
 public:
     enum Role {
         AddressRole = Qt::UserRole + 1,
@@ -33,16 +62,39 @@ public:
     QVariant data(const QModelIndex &index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
 
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+
+    const HistoryEntry &entry(int row) const;
+    QIcon icon(const QString &address) const;
+
+    void reload();
     void add_entry(const HistoryEntry &entry);
+    void update_entry(const HistoryEntry &entry);
     void remove_entry(int offset);
+    void remove_address(const QString &address);
     void remove_entries_by_date(const QDateTime &time);
+    void expire_entries(const QDateTime &cutoff, const QStringList &addresses);
     void remove_all();
+
+Q_SIGNALS:
+    void entry_visited(const HistoryEntry &entry);
+    void entry_changed(const HistoryEntry &entry);
+    void address_removed(const QString &address);
+    void entries_expired(const QDateTime &cutoff, const QStringList &addresses);
+    void icon_loaded(const QString &address);
 };
 
 class HistoryWidget : public QWidget
 {
     QTreeView *m_tree_view = nullptr;
+    QLineEdit *m_search_bar = nullptr;
+    QTreeView *m_search_view = nullptr;
+    ContentSearchModel *m_search_model = nullptr;
+    QTimer *m_search_timer = nullptr;
 
+    void setup_search();
+    void search();
     void show_context_menu(const QPoint &pos);
     void open_in_new_tab(const QModelIndex &index);
 public:
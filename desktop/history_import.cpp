@@ -0,0 +1,191 @@
+#include "database.h"
+#include "history_import.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QUrl>
+
+const QString CONNECTION_NAME = QStringLiteral("history_import");
+const int CHUNK_SIZE = 500;
+
+// Chromium stores times as microseconds since 1601-01-01 UTC
+const qint64 CHROMIUM_EPOCH_OFFSET = Q_INT64_C(11644473600000);
+
+struct HistoryImportJob
+{
+    QTemporaryDir dir;
+    QSqlQuery query;
+    qint64 epoch_offset = 0;
+    HistoryImportResult result;
+};
+
+static bool is_importable(const QString &address)
+{
+    return address.startsWith(QStringLiteral("http://"))
+            || address.startsWith(QStringLiteral("https://"))
+            || address.startsWith(QStringLiteral("ftp://"))
+            || address.startsWith(QStringLiteral("file://"));
+}
+
+static bool copy_database(const QString &path, const QString &target)
+{
+    // Browsers keep their profile databases locked, work on a private copy instead
+    if (!QFile::copy(path, target))
+        return false;
+
+    const QString wal = path + QStringLiteral("-wal");
+    if (QFile::exists(wal))
+        QFile::copy(wal, target + QStringLiteral("-wal"));
+
+    return true;
+}
+
+static bool open_source(HistoryImportJob *job, const QString &path)
+{
+    const QString copy = job->dir.filePath(QStringLiteral("history"));
+    if (!job->dir.isValid() || !copy_database(path, copy)) {
+        job->result.error = QStringLiteral("Could not read %1.").arg(path);
+        return false;
+    }
+
+    QSqlDatabase source = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), CONNECTION_NAME);
+    source.setDatabaseName(copy);
+    // a copied write-ahead log has to be replayed, which needs write access to the private copy
+    if (!QFile::exists(copy + QStringLiteral("-wal")))
+        source.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+    if (!source.open()) {
+        job->result.error = source.lastError().text();
+        return false;
+    }
+
+    const QStringList tables = source.tables();
+    QString sql;
+    if (tables.contains(QStringLiteral("urls"))) {
+        sql = QStringLiteral("SELECT url, title, last_visit_time, visit_count FROM urls WHERE hidden = 0 AND last_visit_time > 0");
+        job->epoch_offset = CHROMIUM_EPOCH_OFFSET;
+    } else if (tables.contains(QStringLiteral("moz_places"))) {
+        sql = QStringLiteral("SELECT url, title, last_visit_date, visit_count FROM moz_places WHERE hidden = 0 AND last_visit_date > 0");
+    } else {
+        job->result.error = QStringLiteral("The file is not a Chromium or Firefox history database.");
+        return false;
+    }
+
+    job->query = QSqlQuery(source);
+    job->query.setForwardOnly(true);
+    if (!job->query.exec(sql)) {
+        job->result.error = job->query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+static void close_source(HistoryImportJob *job)
+{
+    job->query = QSqlQuery();
+    {
+        QSqlDatabase source = QSqlDatabase::database(CONNECTION_NAME, false);
+        source.close();
+    }
+    QSqlDatabase::removeDatabase(CONNECTION_NAME);
+}
+
+// Writes the next CHUNK_SIZE rows in one transaction, returns true while rows are left
+static bool import_chunk(DatabaseWorker *db, HistoryImportJob *job)
+{
+    const QString insert = QStringLiteral("INSERT INTO history (title, address, last_visited, visit_count) VALUES (?, ?, ?, ?) "
+                                          "ON CONFLICT (address) DO UPDATE SET title = excluded.title, last_visited = excluded.last_visited, "
+                                          "visit_count = max(history.visit_count, excluded.visit_count) "
+                                          "WHERE excluded.last_visited > history.last_visited");
+
+    QVector<QVariantList> columns(4);
+    bool has_more = false;
+    while (job->query.next()) {
+        const QString address = job->query.value(0).toString();
+        if (!is_importable(address))
+            continue;
+
+        const qint64 msecs = job->query.value(2).toLongLong() / 1000 - job->epoch_offset;
+        columns[0].append(job->query.value(1).toString());
+        columns[1].append(address);
+        columns[2].append(QDateTime::fromMSecsSinceEpoch(msecs));
+        columns[3].append(qMax(1, job->query.value(3).toInt()));
+
+        if (columns.at(0).count() >= CHUNK_SIZE) {
+            has_more = true;
+            break;
+        }
+    }
+
+    if (columns.at(0).isEmpty())
+        return false;
+
+    db->transaction();
+    if (!db->exec_batch(insert, columns)) {
+        db->rollback();
+        job->result.error = QStringLiteral("Could not write the imported history.");
+        return false;
+    }
+    db->commit();
+
+    job->result.imported += columns.at(0).count();
+    return has_more;
+}
+
+static void finish(const HistoryImportResult &result, const QPointer<QObject> &receiver,
+                   const std::function<void (const HistoryImportResult &)> &callback)
+{
+    if (QObject *object = receiver.data()) {
+        QMetaObject::invokeMethod(object, [callback, result] { callback(result); });
+    }
+}
+
+static void run_chunks(DatabaseWorker *db, const QSharedPointer<HistoryImportJob> &job, const QPointer<QObject> &receiver,
+                       const std::function<void (const HistoryImportResult &)> &callback)
+{
+    db->flush();
+    if (import_chunk(db, job.data())) {
+        // queued behind the reads and writes that arrived meanwhile, so a large import does not stall browsing
+        QMetaObject::invokeMethod(db, [db, job, receiver, callback] {
+            run_chunks(db, job, receiver, callback);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    close_source(job.data());
+    finish(job->result, receiver, callback);
+}
+
+HistoryImporter::HistoryImporter(Database *database)
+    : m_database(database)
+{
+}
+
+void HistoryImporter::import(const QString &path, QObject *context, const std::function<void (const HistoryImportResult &)> &callback)
+{
+    QPointer<QObject> receiver(context);
+    m_database->run([path, receiver, callback] (DatabaseWorker *db) {
+        // the source connection stays open between chunks and is named, so only one import runs at a time
+        if (QSqlDatabase::contains(CONNECTION_NAME)) {
+            HistoryImportResult result;
+            result.error = QStringLiteral("Another history import is still running.");
+            finish(result, receiver, callback);
+            return;
+        }
+
+        QSharedPointer<HistoryImportJob> job(new HistoryImportJob);
+        if (!open_source(job.data(), path)) {
+            close_source(job.data());
+            finish(job->result, receiver, callback);
+            return;
+        }
+
+        run_chunks(db, job, receiver, callback);
+    });
+}
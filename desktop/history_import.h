@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <functional>
+
+class Database;
+
+struct HistoryImportResult
+{
+    int imported = 0;
+    QString error;
+};
+
+class HistoryImporter
+{
+    Database *m_database = nullptr;
+public:
+    explicit HistoryImporter(Database *database);
+
+    void import(const QString &path, QObject *context, const std::function<void (const HistoryImportResult &)> &callback);
+};
@@ -0,0 +1,347 @@
+#include "database.h"
+#include "history_index.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QSqlQuery>
+
+const int INDEX_INTERVAL = 3000;
+const int REINDEX_INTERVAL = 60 * 60;
+const int MAX_CONTENT_LENGTH = 64 * 1024;
+const int MAX_TRACKED_ADDRESSES = 1000;
+const int SEARCH_LIMIT = 50;
+const int SNIPPET_BEFORE = 60;
+const int SNIPPET_AFTER = 120;
+
+struct ContentRow
+{
+    qint64 id;
+    QString title;
+    QByteArray content;
+};
+
+static QStringList search_terms(const QString &text)
+{
+    static const QRegularExpression separator(QStringLiteral("[^\\w]+"), QRegularExpression::UseUnicodePropertiesOption);
+    return text.toLower().split(separator, Qt::SkipEmptyParts);
+}
+
+static bool remove_rows(DatabaseWorker *db, const QString &sql, const QVariant &value)
+{
+    QVector<ContentRow> rows;
+    bool ok = db->exec(sql, QVariantList { value }, [&rows] (QSqlQuery &query) {
+        while (query.next()) {
+            rows.append(ContentRow { query.value(0).toLongLong(), query.value(1).toString(), query.value(2).toByteArray() });
+        }
+    });
+
+    for (const ContentRow &row : qAsConst(rows)) {
+        if (!ok)
+            break;
+
+        ok = db->exec(QStringLiteral("INSERT INTO history_fts (history_fts, rowid, title, content) VALUES ('delete', ?, ?, ?)"),
+                      QVariantList { row.id, row.title, QString::fromUtf8(qUncompress(row.content)) })
+                && db->exec(QStringLiteral("DELETE FROM history_content WHERE id = ?"), QVariantList { row.id });
+    }
+
+    return ok;
+}
+
+static QString make_snippet(const QString &content, const QStringList &terms)
+{
+    int position = -1;
+    for (const QString &term : terms) {
+        int index = content.indexOf(term, 0, Qt::CaseInsensitive);
+        if (index != -1 && (position == -1 || index < position))
+            position = index;
+    }
+
+    if (position == -1)
+        position = 0;
+
+    const int start = qMax(0, position - SNIPPET_BEFORE);
+    QString snippet = content.mid(start, SNIPPET_BEFORE + SNIPPET_AFTER).simplified();
+    if (start > 0)
+        snippet.prepend(QStringLiteral("..."));
+    if (start + SNIPPET_BEFORE + SNIPPET_AFTER < content.length())
+        snippet.append(QStringLiteral("..."));
+    return snippet;
+}
+
+static bool is_ready(DatabaseWorker *db)
+{
+    return db->has_table(QStringLiteral("history_content")) && db->has_table(QStringLiteral("history_fts"));
+}
+
+static void index_page(DatabaseWorker *db, const QString &address, const QString &title, const QString &text, const QDateTime &visited)
+{
+    if (!is_ready(db))
+        return;
+
+    db->transaction();
+
+    QVariant id;
+    bool ok = remove_rows(db, QStringLiteral("SELECT id, title, content FROM history_content WHERE address = ?"), address)
+            && db->exec(QStringLiteral("INSERT INTO history_content (address, title, content, visited) VALUES (?, ?, ?, ?)"),
+                        QVariantList { address, title, qCompress(text.toUtf8()), visited }, [&id] (QSqlQuery &query) {
+        id = query.lastInsertId();
+    })
+            && id.isValid()
+            && db->exec(QStringLiteral("INSERT INTO history_fts (rowid, title, content) VALUES (?, ?, ?)"), QVariantList { id, title, text });
+
+    if (ok) {
+        db->commit();
+        return;
+    }
+
+    // exec logs the statement that failed with its own error, this names the page it was for
+    qDebug() << "Error indexing" << address;
+    db->rollback();
+}
+
+static void remove_matching(DatabaseWorker *db, const QString &sql, const QVariant &value)
+{
+    if (!is_ready(db))
+        return;
+
+    db->transaction();
+    if (remove_rows(db, sql, value))
+        db->commit();
+    else
+        db->rollback();
+}
+
+static QVector<ContentMatch> search_content(DatabaseWorker *db, const QString &text, int limit)
+{
+    QVector<ContentMatch> matches;
+    if (!is_ready(db))
+        return matches;
+
+    const QStringList terms = search_terms(text);
+    if (terms.isEmpty())
+        return matches;
+
+    QStringList phrases;
+    for (const QString &term : terms) {
+        phrases << QStringLiteral("\"%1\"*").arg(term);
+    }
+
+    db->exec(QStringLiteral("SELECT c.title, c.address, c.content, bm25(history_fts) AS score FROM history_fts "
+                            "JOIN history_content c ON c.id = history_fts.rowid "
+                            "WHERE history_fts MATCH ? ORDER BY score LIMIT ?"),
+             QVariantList { phrases.join(QLatin1Char(' ')), limit }, [&matches, &terms] (QSqlQuery &query) {
+        while (query.next()) {
+            ContentMatch match;
+            match.title = query.value(0).toString();
+            match.address = query.value(1).toString();
+            match.snippet = make_snippet(QString::fromUtf8(qUncompress(query.value(2).toByteArray())), terms);
+            match.score = query.value(3).toDouble();
+            matches.append(match);
+        }
+    });
+
+    return matches;
+}
+
+void HistoryIndexer::process_next()
+{
+    if (!m_loading_pages.isEmpty()) {
+        m_timer->start();
+        return;
+    }
+
+    while (!m_queue.isEmpty()) {
+        QPointer<QWebEnginePage> page = m_queue.dequeue();
+        if (!page)
+            continue;
+
+        const QString address = page->url().toString();
+        const QString title = page->title();
+        const QDateTime visited = QDateTime::currentDateTime();
+
+        if (m_last_indexed.count() > MAX_TRACKED_ADDRESSES)
+            m_last_indexed.clear();
+        m_last_indexed.insert(address, visited);
+
+        QPointer<HistoryIndexer> self(this);
+        page->toPlainText([self, address, title, visited](const QString &text) {
+            if (!self || text.trimmed().isEmpty())
+                return;
+
+            const QString content = text.left(MAX_CONTENT_LENGTH);
+            self->m_database->run([address, title, content, visited] (DatabaseWorker *db) {
+                index_page(db, address, title, content, visited);
+            });
+        });
+        break;
+    }
+
+    if (!m_queue.isEmpty())
+        m_timer->start();
+}
+
+HistoryIndexer::HistoryIndexer(Database *database, QObject *parent)
+    : QObject(parent)
+    , m_database(database)
+{
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(INDEX_INTERVAL);
+    connect(m_timer, &QTimer::timeout, this, &HistoryIndexer::process_next);
+}
+
+HistoryIndexer::~HistoryIndexer()
+{
+    for (const QMetaObject::Connection &connection : qAsConst(m_loading_pages)) {
+        disconnect(connection);
+    }
+}
+
+void HistoryIndexer::page_load_started(QWebEnginePage *page)
+{
+    if (m_loading_pages.contains(page))
+        return;
+
+    QMetaObject::Connection connection = connect(page, &QObject::destroyed, this, [this, page] {
+        m_loading_pages.remove(page);
+    });
+    m_loading_pages.insert(page, connection);
+}
+
+void HistoryIndexer::page_load_finished(QWebEnginePage *page, bool ok)
+{
+    if (m_loading_pages.contains(page))
+        disconnect(m_loading_pages.take(page));
+
+    if (!ok)
+        return;
+
+    const QUrl url = page->url();
+    if (url.scheme() != QStringLiteral("http") && url.scheme() != QStringLiteral("https"))
+        return;
+
+    const QDateTime last_indexed = m_last_indexed.value(url.toString());
+    if (last_indexed.isValid() && last_indexed.secsTo(QDateTime::currentDateTime()) < REINDEX_INTERVAL)
+        return;
+
+    for (const QPointer<QWebEnginePage> &queued : qAsConst(m_queue)) {
+        if (queued == page)
+            return;
+    }
+
+    m_queue.enqueue(page);
+    if (!m_timer->isActive())
+        m_timer->start();
+}
+
+void HistoryIndexer::remove_address(const QString &address)
+{
+    m_last_indexed.remove(address);
+
+    m_database->run([address] (DatabaseWorker *db) {
+        remove_matching(db, QStringLiteral("SELECT id, title, content FROM history_content WHERE address = ?"), address);
+    });
+}
+
+void HistoryIndexer::remove_since(const QDateTime &time)
+{
+    m_last_indexed.clear();
+
+    m_database->run([time] (DatabaseWorker *db) {
+        remove_matching(db, QStringLiteral("SELECT id, title, content FROM history_content WHERE visited > ?"), time);
+    });
+}
+
+void HistoryIndexer::remove_until(const QDateTime &time)
+{
+    m_database->run([time] (DatabaseWorker *db) {
+        remove_matching(db, QStringLiteral("SELECT id, title, content FROM history_content WHERE visited <= ?"), time);
+    });
+}
+
+void HistoryIndexer::remove_all()
+{
+    m_queue.clear();
+    m_last_indexed.clear();
+
+    m_database->run([] (DatabaseWorker *db) {
+        if (!is_ready(db))
+            return;
+
+        db->transaction();
+        if (db->exec(QStringLiteral("INSERT INTO history_fts (history_fts) VALUES ('delete-all')"))
+                && db->exec(QStringLiteral("DELETE FROM history_content")))
+            db->commit();
+        else
+            db->rollback();
+    });
+}
+
+void HistoryIndexer::search(const QString &text, QObject *context, const std::function<void (const QVector<ContentMatch> &)> &callback)
+{
+    m_database->read<QVector<ContentMatch>>([text] (DatabaseWorker *db) {
+        return search_content(db, text, SEARCH_LIMIT);
+    }, context, callback);
+}
+
+ContentSearchModel::ContentSearchModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int ContentSearchModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_matches.count();
+}
+
+int ContentSearchModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 3;
+}
+
+QVariant ContentSearchModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_matches.count())
+        return QVariant();
+
+    const ContentMatch &match = m_matches.at(index.row());
+
+    switch (role) {
+    case AddressRole:
+        return match.address;
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case 0: return match.title;
+        case 1: return match.address;
+        case 2: return match.snippet;
+        default: break;
+        }
+        break;
+    case Qt::ToolTipRole:
+        if (index.column() == 2)
+            return match.snippet;
+        break;
+    }
+
+    return QVariant();
+}
+
+QVariant ContentSearchModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        switch (section) {
+        case 0: return QStringLiteral("Title");
+        case 1: return QStringLiteral("Address");
+        case 2: return QStringLiteral("Content");
+        }
+    }
+
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+void ContentSearchModel::set_matches(const QVector<ContentMatch> &matches)
+{
+    beginResetModel();
+    m_matches = matches;
+    endResetModel();
+}
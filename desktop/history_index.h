@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QTimer>
+#include <QVector>
+#include <QWebEnginePage>
+
+#include <functional>
+
+struct ContentMatch
+{
+    QString title;
+    QString address;
+    QString snippet;
+    double score = 0;
+};
+
+class Database;
+
+class HistoryIndexer : public QObject
+{
+    Database *m_database = nullptr;
+
+    QTimer *m_timer = nullptr;
+    QQueue<QPointer<QWebEnginePage>> m_queue;
+    QHash<QObject *, QMetaObject::Connection> m_loading_pages;
+    QHash<QString, QDateTime> m_last_indexed;
+
+    void process_next();
+public:
+    explicit HistoryIndexer(Database *database, QObject *parent = nullptr);
+    ~HistoryIndexer();
+
+    void page_load_started(QWebEnginePage *page);
+    void page_load_finished(QWebEnginePage *page, bool ok);
+
+    void remove_address(const QString &address);
+    void remove_since(const QDateTime &time);
+    void remove_until(const QDateTime &time);
+    void remove_all();
+    void search(const QString &text, QObject *context, const std::function<void (const QVector<ContentMatch> &)> &callback);
+};
+
+class ContentSearchModel : public QAbstractTableModel
+{
+    QVector<ContentMatch> m_matches;
+public:
+    enum Role {
+        AddressRole = Qt::UserRole + 1,
+    };
+    explicit ContentSearchModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent) const;
+    int columnCount(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+
+    void set_matches(const QVector<ContentMatch> &matches);
+};
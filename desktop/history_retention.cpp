@@ -0,0 +1,155 @@
+#include "browser.h"
+#include "database.h"
+#include "history.h"
+#include "history_index.h"
+#include "history_retention.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QSettings>
+#include <QSqlQuery>
+
+const int BATCH_SIZE = 500;
+const int VACUUM_PAGES = 256;
+const int FIRST_RUN_DELAY = 60 * 1000;
+const int BATCH_INTERVAL = 2 * 1000;
+const int EXPIRY_INTERVAL = 30 * 60 * 1000;
+
+struct ExpiryResult
+{
+    QDateTime cutoff;
+    QStringList addresses;
+    bool has_more = false;
+};
+
+// converting an existing file rewrites all of it, so it waits until retention is switched on
+static void enable_incremental_vacuum(DatabaseWorker *db)
+{
+    int mode = 0;
+    db->exec(QStringLiteral("PRAGMA auto_vacuum"), QVariantList(), [&mode] (QSqlQuery &query) {
+        if (query.next())
+            mode = query.value(0).toInt();
+    });
+    if (mode == 2)
+        return;
+
+    if (!db->exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL")) || !db->exec(QStringLiteral("VACUUM")))
+        qDebug() << "Error converting history database to incremental vacuum";
+}
+
+static ExpiryResult expire(DatabaseWorker *db, const RetentionPolicy &policy)
+{
+    ExpiryResult result;
+    int excess = 0;
+
+    if (policy.max_age_days > 0) {
+        const QDateTime oldest = QDateTime::currentDateTime().addDays(-policy.max_age_days);
+        db->exec(QStringLiteral("SELECT COUNT(*) FROM history WHERE last_visited < ?"), QVariantList { oldest }, [&excess] (QSqlQuery &query) {
+            if (query.next())
+                excess = qMax(excess, query.value(0).toInt());
+        });
+    }
+
+    if (policy.max_entries > 0) {
+        db->exec(QStringLiteral("SELECT COUNT(*) FROM history"), QVariantList(), [&excess, &policy] (QSqlQuery &query) {
+            if (query.next())
+                excess = qMax(excess, query.value(0).toInt() - policy.max_entries);
+        });
+    }
+
+    if (policy.max_size_mb > 0) {
+        qint64 size = 0;
+        db->exec(QStringLiteral("SELECT (page_count - freelist_count) * page_size FROM pragma_page_count(), pragma_freelist_count(), pragma_page_size()"),
+                 QVariantList(), [&size] (QSqlQuery &query) {
+            if (query.next())
+                size = query.value(0).toLongLong();
+        });
+
+        if (size > qint64(policy.max_size_mb) * 1024 * 1024)
+            excess = BATCH_SIZE;
+    }
+
+    excess = qMin(excess, BATCH_SIZE);
+    if (excess > 0) {
+        db->exec(QStringLiteral("SELECT last_visited FROM history ORDER BY last_visited ASC LIMIT 1 OFFSET ?"), QVariantList { excess - 1 }, [&result] (QSqlQuery &query) {
+            if (query.next())
+                result.cutoff = query.value(0).toDateTime();
+        });
+    }
+
+    if (result.cutoff.isValid()) {
+        db->transaction();
+        const bool ok = db->exec(QStringLiteral("SELECT address FROM history WHERE last_visited <= ?"), QVariantList { result.cutoff }, [&result] (QSqlQuery &query) {
+            while (query.next()) {
+                result.addresses.append(query.value(0).toString());
+            }
+        }) && db->exec(QStringLiteral("DELETE FROM history WHERE last_visited <= ?"), QVariantList { result.cutoff });
+
+        if (ok) {
+            db->commit();
+            result.has_more = excess == BATCH_SIZE;
+        } else {
+            db->rollback();
+            result.cutoff = QDateTime();
+            result.addresses.clear();
+        }
+    }
+
+    db->exec(QStringLiteral("PRAGMA incremental_vacuum(%1)").arg(VACUUM_PAGES), QVariantList(), [] (QSqlQuery &query) {
+        while (query.next()) { }
+    });
+
+    return result;
+}
+
+bool RetentionPolicy::is_enabled() const
+{
+    return max_age_days > 0 || max_entries > 0 || max_size_mb > 0;
+}
+
+RetentionPolicy RetentionPolicy::from_settings()
+{
+    QSettings settings;
+    RetentionPolicy policy;
+    policy.max_age_days = settings.value(QStringLiteral("history/max_age_days"), policy.max_age_days).toInt();
+    policy.max_entries = settings.value(QStringLiteral("history/max_entries"), policy.max_entries).toInt();
+    policy.max_size_mb = settings.value(QStringLiteral("history/max_size_mb"), policy.max_size_mb).toInt();
+    return policy;
+}
+
+void HistoryRetention::expire_batch()
+{
+    const RetentionPolicy policy = RetentionPolicy::from_settings();
+    if (!policy.is_enabled()) {
+        m_timer->start(EXPIRY_INTERVAL);
+        return;
+    }
+
+    const bool check_vacuum = !m_is_vacuum_checked;
+    m_is_vacuum_checked = true;
+
+    m_database->read<ExpiryResult>([policy, check_vacuum] (DatabaseWorker *db) {
+        if (check_vacuum)
+            enable_incremental_vacuum(db);
+        return expire(db, policy);
+    }, this, [this] (const ExpiryResult &result) {
+        if (result.cutoff.isValid()) {
+            m_history_model->expire_entries(result.cutoff, result.addresses);
+            if (browser->history_indexer())
+                browser->history_indexer()->remove_until(result.cutoff);
+        }
+
+        m_timer->start(result.has_more ? BATCH_INTERVAL : EXPIRY_INTERVAL);
+    });
+}
+
+HistoryRetention::HistoryRetention(Database *database, HistoryModel *history_model, QObject *parent)
+    : QObject(parent)
+    , m_database(database)
+    , m_history_model(history_model)
+{
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &HistoryRetention::expire_batch);
+    m_timer->start(FIRST_RUN_DELAY);
+}
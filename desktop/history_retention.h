@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+class Database;
+class HistoryModel;
+
+struct RetentionPolicy
+{
+    int max_age_days = 0;
+    int max_entries = 0;
+    int max_size_mb = 0;
+
+    bool is_enabled() const;
+    static RetentionPolicy from_settings();
+};
+
+class HistoryRetention : public QObject
+{
+    Database *m_database = nullptr;
+    HistoryModel *m_history_model = nullptr;
+    QTimer *m_timer = nullptr;
+    bool m_is_vacuum_checked = false;
+
+    void expire_batch();
+public:
+    explicit HistoryRetention(Database *database, HistoryModel *history_model, QObject *parent = nullptr);
+};
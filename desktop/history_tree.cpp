@@ -0,0 +1,397 @@
+#include "database.h"
+#include "history_tree.h"
+
+#include <QLocale>
+#include <QSqlQuery>
+
+#include <algorithm>
+
+const int DAY_BUCKETS = 7;
+const int FETCH_LIMIT = 500;
+
+static QString day_title(const QDate &date)
+{
+    const QDate today = QDate::currentDate();
+    if (date == today)
+        return QStringLiteral("Today");
+    if (date == today.addDays(-1))
+        return QStringLiteral("Yesterday");
+    return QLocale().toString(date, QStringLiteral("dddd, MMMM d"));
+}
+
+static QVector<HistoryBucket> load_buckets(DatabaseWorker *db)
+{
+    QVector<HistoryBucket> buckets;
+    const QDateTime week_start = QDate::currentDate().addDays(1 - DAY_BUCKETS).startOfDay();
+
+    // last_visited is stored as an ISO 8601 string, so its prefixes are the day and the month
+    db->exec(QStringLiteral("SELECT substr(last_visited, 1, 10) AS day, COUNT(*) FROM history "
+                            "WHERE last_visited >= ? GROUP BY day ORDER BY day DESC"),
+             QVariantList { week_start }, [&buckets] (QSqlQuery &query) {
+        while (query.next()) {
+            const QDate date = QDate::fromString(query.value(0).toString(), Qt::ISODate);
+            if (!date.isValid())
+                continue;
+
+            HistoryBucket bucket;
+            bucket.title = day_title(date);
+            bucket.start = date.startOfDay();
+            bucket.end = date.addDays(1).startOfDay();
+            bucket.count = query.value(1).toInt();
+            buckets.append(bucket);
+        }
+    });
+
+    db->exec(QStringLiteral("SELECT substr(last_visited, 1, 7) AS month, COUNT(*) FROM history "
+                            "WHERE last_visited < ? GROUP BY month ORDER BY month DESC"),
+             QVariantList { week_start }, [&buckets, &week_start] (QSqlQuery &query) {
+        while (query.next()) {
+            const QDate date = QDate::fromString(query.value(0).toString() + QStringLiteral("-01"), Qt::ISODate);
+            if (!date.isValid())
+                continue;
+
+            HistoryBucket bucket;
+            bucket.title = QLocale().toString(date, QStringLiteral("MMMM yyyy"));
+            bucket.start = date.startOfDay();
+            bucket.end = qMin(date.addMonths(1).startOfDay(), week_start);
+            bucket.count = query.value(1).toInt();
+            buckets.append(bucket);
+        }
+    });
+
+    return buckets;
+}
+
+int HistoryTreeModel::bucket_row(const QDateTime &time) const
+{
+    // buckets are ordered by start descending and do not overlap
+    auto it = std::partition_point(m_buckets.constBegin(), m_buckets.constEnd(), [&time] (const HistoryBucket *bucket) {
+        return bucket->start > time;
+    });
+
+    if (it == m_buckets.constEnd() || time >= (*it)->end)
+        return -1;
+    return it - m_buckets.constBegin();
+}
+
+void HistoryTreeModel::insert_entry(const HistoryEntry &entry)
+{
+    // a revisit moves the entry out of whichever bucket held it before
+    remove_address(entry.address);
+
+    int row = bucket_row(entry.last_visited);
+    if (row == -1) {
+        const QDate date = entry.last_visited.date();
+        auto it = std::partition_point(m_buckets.begin(), m_buckets.end(), [&entry] (const HistoryBucket *bucket) {
+            return bucket->start > entry.last_visited;
+        });
+        row = it - m_buckets.begin();
+
+        HistoryBucket *bucket = new HistoryBucket;
+        bucket->title = day_title(date);
+        bucket->start = date.startOfDay();
+        bucket->end = date.addDays(1).startOfDay();
+        bucket->is_complete = true;
+
+        beginInsertRows(QModelIndex(), row, row);
+        m_buckets.insert(row, bucket);
+        endInsertRows();
+    }
+
+    HistoryBucket *bucket = m_buckets.at(row);
+    bucket->count++;
+
+    // entries older than everything fetched so far are picked up by the next fetchMore
+    auto it = std::partition_point(bucket->entries.begin(), bucket->entries.end(), [&entry] (const HistoryEntry &loaded) {
+        return loaded.last_visited > entry.last_visited;
+    });
+    const int position = it - bucket->entries.begin();
+    if (position == bucket->entries.count() && !bucket->is_complete)
+        return;
+
+    beginInsertRows(index(row, 0), position, position);
+    bucket->entries.insert(position, entry);
+    endInsertRows();
+}
+
+void HistoryTreeModel::remove_address(const QString &address)
+{
+    // only fetched entries can be found, a bucket that empties without them is dropped by its next fetch
+    for (int row = 0; row < m_buckets.count(); row++) {
+        HistoryBucket *bucket = m_buckets.at(row);
+        for (int i = 0; i < bucket->entries.count(); i++) {
+            if (bucket->entries.at(i).address != address)
+                continue;
+
+            if (--bucket->count <= 0) {
+                remove_bucket(row);
+                return;
+            }
+
+            beginRemoveRows(index(row, 0), i, i);
+            bucket->entries.remove(i);
+            endRemoveRows();
+            return;
+        }
+    }
+}
+
+void HistoryTreeModel::update_address(const QString &address, const QString &title)
+{
+    for (int row = 0; row < m_buckets.count(); row++) {
+        HistoryBucket *bucket = m_buckets.at(row);
+        for (int i = 0; i < bucket->entries.count(); i++) {
+            if (bucket->entries.at(i).address != address)
+                continue;
+
+            if (!title.isNull())
+                bucket->entries[i].title = title;
+
+            const QModelIndex parent = index(row, 0);
+            emit dataChanged(index(i, 0, parent), index(i, columnCount(parent) - 1, parent));
+        }
+    }
+}
+
+void HistoryTreeModel::expire(const QDateTime &cutoff)
+{
+    // buckets are ordered newest first, everything up to the cutoff is gone from the database
+    for (int row = m_buckets.count() - 1; row >= 0; row--) {
+        HistoryBucket *bucket = m_buckets.at(row);
+        if (bucket->start > cutoff)
+            break;
+
+        auto it = std::partition_point(bucket->entries.begin(), bucket->entries.end(), [&cutoff] (const HistoryEntry &entry) {
+            return entry.last_visited > cutoff;
+        });
+        const int first = it - bucket->entries.begin();
+        const int count = bucket->entries.count() - first;
+
+        bucket->count -= count;
+        if (bucket->end <= cutoff || bucket->count <= 0 || (first == 0 && bucket->is_complete)) {
+            remove_bucket(row);
+            continue;
+        }
+
+        if (count > 0) {
+            beginRemoveRows(index(row, 0), first, bucket->entries.count() - 1);
+            bucket->entries.remove(first, count);
+            endRemoveRows();
+        }
+    }
+}
+
+void HistoryTreeModel::remove_bucket(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    delete m_buckets.takeAt(row);
+    endRemoveRows();
+}
+
+HistoryTreeModel::HistoryTreeModel(Database *database, HistoryModel *history_model, QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_database(database)
+    , m_history_model(history_model)
+{
+    connect(m_history_model, &HistoryModel::entry_visited, this, &HistoryTreeModel::insert_entry);
+    connect(m_history_model, &HistoryModel::entry_changed, this, [this] (const HistoryEntry &entry) {
+        update_address(entry.address, entry.title);
+    });
+    connect(m_history_model, &HistoryModel::icon_loaded, this, [this] (const QString &address) {
+        update_address(address, QString());
+    });
+    connect(m_history_model, &HistoryModel::address_removed, this, &HistoryTreeModel::remove_address);
+    connect(m_history_model, &HistoryModel::entries_expired, this, &HistoryTreeModel::expire);
+    connect(m_history_model, &QAbstractItemModel::modelReset, this, &HistoryTreeModel::refresh);
+
+    refresh();
+}
+
+HistoryTreeModel::~HistoryTreeModel()
+{
+    qDeleteAll(m_buckets);
+}
+
+QModelIndex HistoryTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+        return QModelIndex();
+
+    if (!parent.isValid())
+        return createIndex(row, column, nullptr);
+
+    return createIndex(row, column, m_buckets.at(parent.row()));
+}
+
+QModelIndex HistoryTreeModel::parent(const QModelIndex &index) const
+{
+    HistoryBucket *bucket = static_cast<HistoryBucket *>(index.internalPointer());
+    if (!index.isValid() || !bucket)
+        return QModelIndex();
+
+    return createIndex(m_buckets.indexOf(bucket), 0, nullptr);
+}
+
+int HistoryTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+        return m_buckets.count();
+
+    if (parent.column() != 0 || parent.internalPointer())
+        return 0;
+
+    return m_buckets.at(parent.row())->entries.count();
+}
+
+int HistoryTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 2;
+}
+
+bool HistoryTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+        return !m_buckets.isEmpty();
+
+    if (parent.column() != 0 || parent.internalPointer())
+        return false;
+
+    return m_buckets.at(parent.row())->count > 0;
+}
+
+QVariant HistoryTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    HistoryBucket *bucket = static_cast<HistoryBucket *>(index.internalPointer());
+    if (!bucket) {
+        if (role == Qt::DisplayRole && index.column() == 0)
+            return m_buckets.at(index.row())->title;
+        return QVariant();
+    }
+
+    const HistoryEntry &entry = bucket->entries.at(index.row());
+
+    switch (role) {
+    case HistoryModel::AddressRole:
+        return entry.address;
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case 0: return entry.title;
+        case 1: return entry.address;
+        default: break;
+        }
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == 0)
+            return m_history_model->icon(entry.address);
+        break;
+    }
+
+    return QVariant();
+}
+
+QVariant HistoryTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        switch (section) {
+        case 0: return QStringLiteral("Title");
+        case 1: return QStringLiteral("Address");
+        }
+    }
+
+    return QAbstractItemModel::headerData(section, orientation, role);
+}
+
+bool HistoryTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid() || parent.internalPointer())
+        return false;
+
+    const HistoryBucket *bucket = m_buckets.at(parent.row());
+    return !bucket->is_complete && !bucket->is_fetching;
+}
+
+void HistoryTreeModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    HistoryBucket *bucket = m_buckets.at(parent.row());
+    bucket->is_fetching = true;
+
+    // page from the last fetched row so entries added while fetching do not shift the window;
+    // the first page starts at the bucket end, where rowid 0 excludes rows stamped exactly at it
+    const QDateTime start = bucket->start;
+    const QVariant end = bucket->cursor_visited.isValid() ? bucket->cursor_visited : QVariant(bucket->end);
+    const qint64 end_rowid = bucket->cursor_rowid;
+    const int generation = m_generation;
+
+    m_database->read<QVector<StoredHistoryEntry>>([start, end, end_rowid] (DatabaseWorker *db) {
+        return load_history(db, start, end, end_rowid, FETCH_LIMIT);
+    }, this, [this, bucket, generation] (const QVector<StoredHistoryEntry> &fetched) {
+        const int row = m_buckets.indexOf(bucket);
+        if (generation != m_generation || row == -1)
+            return;
+
+        bucket->is_fetching = false;
+        bucket->is_complete = fetched.count() < FETCH_LIMIT;
+        if (fetched.isEmpty()) {
+            // its entries were revisited or expired while none of them were fetched
+            if (bucket->entries.isEmpty())
+                remove_bucket(row);
+            return;
+        }
+
+        bucket->cursor_visited = fetched.last().visited_key;
+        bucket->cursor_rowid = fetched.last().rowid;
+
+        const int first = bucket->entries.count();
+        beginInsertRows(index(row, 0), first, first + fetched.count() - 1);
+        for (const StoredHistoryEntry &fetched_entry : fetched) {
+            HistoryEntry entry;
+            entry.title = fetched_entry.title;
+            entry.address = fetched_entry.address;
+            entry.last_visited = fetched_entry.last_visited;
+            bucket->entries.append(entry);
+        }
+        endInsertRows();
+    });
+}
+
+void HistoryTreeModel::refresh()
+{
+    const int generation = ++m_generation;
+
+    m_database->read<QVector<HistoryBucket>>(load_buckets, this, [this, generation] (const QVector<HistoryBucket> &buckets) {
+        if (generation != m_generation)
+            return;
+
+        beginResetModel();
+        qDeleteAll(m_buckets);
+        m_buckets.clear();
+        for (const HistoryBucket &bucket : buckets) {
+            m_buckets.append(new HistoryBucket(bucket));
+        }
+        m_generation++;
+        endResetModel();
+    });
+}
+
+void HistoryTreeModel::trim()
+{
+    // fetched pages are dropped and fetched again when their bucket is expanded
+    beginResetModel();
+    for (HistoryBucket *bucket : qAsConst(m_buckets)) {
+        bucket->entries.clear();
+        bucket->entries.squeeze();
+        bucket->cursor_visited = QVariant();
+        bucket->cursor_rowid = 0;
+        bucket->is_complete = bucket->count == 0;
+        bucket->is_fetching = false;
+    }
+    m_generation++;
+    endResetModel();
+}
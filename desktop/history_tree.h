@@ -0,0 +1,55 @@
+#pragma once
+
+#include "history.h"
+
+#include <QAbstractItemModel>
+#include <QDateTime>
+#include <QVariant>
+#include <QVector>
+
+class Database;
+
+struct HistoryBucket
+{
+    QString title;
+    QDateTime start;
+    QDateTime end;
+    int count = 0;
+    QVariant cursor_visited;
+    qint64 cursor_rowid = 0;
+    bool is_complete = false;
+    bool is_fetching = false;
+    QVector<HistoryEntry> entries;
+};
+
+class HistoryTreeModel : public QAbstractItemModel
+{
+    Database *m_database = nullptr;
+    HistoryModel *m_history_model = nullptr;
+    QVector<HistoryBucket *> m_buckets;
+    int m_generation = 0;
+
+    int bucket_row(const QDateTime &time) const;
+    void insert_entry(const HistoryEntry &entry);
+    void remove_address(const QString &address);
+    void update_address(const QString &address, const QString &title);
+    void expire(const QDateTime &cutoff);
+    void remove_bucket(int row);
+public:
+    explicit HistoryTreeModel(Database *database, HistoryModel *history_model, QObject *parent = nullptr);
+    ~HistoryTreeModel();
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &index) const;
+    int rowCount(const QModelIndex &parent) const;
+    int columnCount(const QModelIndex &parent) const;
+    bool hasChildren(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+
+    void refresh();
+    void trim();
+};
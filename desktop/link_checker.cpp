@@ -0,0 +1,201 @@
+#include "link_checker.h"
+
+#include <QNetworkRequest>
+#include <QTimer>
+
+const int MAX_REDIRECTS = 5;
+
+void LinkChecker::start_next()
+{
+    // round robin over hosts so one large site does not starve the others
+    for (int i = 0; i < m_hosts.count() && m_active < m_max_active;) {
+        const QString host = m_hosts.at(i);
+        QQueue<Check> &queue = m_pending[host];
+        if (m_active_per_host.value(host) >= m_max_per_host) {
+            i++;
+            continue;
+        }
+
+        const Check check = queue.dequeue();
+        if (queue.isEmpty()) {
+            m_pending.remove(host);
+            m_hosts.removeAt(i);
+        } else {
+            m_hosts.move(i, m_hosts.count() - 1);
+        }
+
+        m_active++;
+        m_active_per_host[host]++;
+        send(check);
+    }
+
+    if (m_active == 0 && m_hosts.isEmpty() && m_finished_callback) {
+        auto callback = m_finished_callback;
+        m_result_callback = nullptr;
+        m_finished_callback = nullptr;
+        if (m_context)
+            callback();
+    }
+}
+
+void LinkChecker::send(const Check &check)
+{
+    QNetworkRequest request(check.url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+
+    QNetworkReply *reply = check.use_get ? m_manager->get(request) : m_manager->head(request);
+    m_replies.insert(reply);
+
+    QTimer *timer = new QTimer(reply);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, reply, [reply] {
+        reply->setProperty("timed_out", true);
+        reply->abort();
+    });
+    timer->start(m_timeout);
+
+    if (check.use_get) {
+        // only the status line matters, stop a GET once the headers are in
+        connect(reply, &QNetworkReply::metaDataChanged, reply, [reply] {
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+                reply->setProperty("has_headers", true);
+                reply->abort();
+            }
+        });
+    }
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, check] {
+        handle_reply(reply, check);
+    });
+}
+
+void LinkChecker::handle_reply(QNetworkReply *reply, Check check)
+{
+    reply->deleteLater();
+    if (!m_replies.remove(reply))
+        return;
+
+    LinkCheckResult result;
+    result.address = check.address;
+    result.http_status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    const bool has_headers = reply->property("has_headers").toBool();
+    if (reply->error() != QNetworkReply::NoError && !has_headers && result.http_status == 0) {
+        result.status = LinkCheckResult::Failed;
+        result.error = reply->property("timed_out").toBool() ? QStringLiteral("Timed out") : reply->errorString();
+        finish(check, result);
+        return;
+    }
+
+    // servers that do not implement HEAD get a second chance with GET
+    const int status = result.http_status;
+    if (!check.use_get && (status == 405 || status == 501 || status == 403)) {
+        check.use_get = true;
+        send(check);
+        return;
+    }
+
+    if (status >= 300 && status < 400 && status != 304) {
+        const QUrl location = check.url.resolved(reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl());
+        if (location.isValid() && location != check.url && check.redirects < MAX_REDIRECTS) {
+            check.is_permanent = check.is_permanent && (status == 301 || status == 308);
+            check.redirects++;
+            check.url = location;
+            send(check);
+            return;
+        }
+    }
+
+    if (check.redirects > 0)
+        result.location = check.url.toString();
+
+    if (status >= 400 || (status >= 300 && status < 400 && status != 304)) {
+        result.status = LinkCheckResult::Broken;
+        result.error = reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toString();
+    } else if (check.redirects > 0) {
+        result.status = check.is_permanent ? LinkCheckResult::Moved : LinkCheckResult::Redirected;
+    } else {
+        result.status = LinkCheckResult::Ok;
+    }
+
+    finish(check, result);
+}
+
+void LinkChecker::finish(const Check &check, const LinkCheckResult &result)
+{
+    m_active--;
+    if (--m_active_per_host[check.host] <= 0)
+        m_active_per_host.remove(check.host);
+
+    if (m_context && m_result_callback)
+        m_result_callback(result);
+
+    start_next();
+}
+
+LinkChecker::LinkChecker(QObject *parent)
+    : QObject(parent)
+{
+    m_manager = new QNetworkAccessManager(this);
+}
+
+LinkChecker::~LinkChecker()
+{
+    cancel();
+}
+
+void LinkChecker::set_limits(int max_active, int max_per_host)
+{
+    m_max_active = qMax(1, max_active);
+    m_max_per_host = qMax(1, max_per_host);
+}
+
+void LinkChecker::set_timeout(int msecs)
+{
+    m_timeout = msecs;
+}
+
+void LinkChecker::check(const QStringList &addresses, QObject *context, const std::function<void (const LinkCheckResult &)> &result_callback,
+                        const std::function<void ()> &finished_callback)
+{
+    cancel();
+
+    m_context = context;
+    m_result_callback = result_callback;
+    m_finished_callback = finished_callback;
+
+    for (const QString &address : addresses) {
+        Check check;
+        check.address = address;
+        check.url = QUrl(address);
+        check.host = check.url.host().toLower();
+
+        if (!m_pending.contains(check.host))
+            m_hosts.append(check.host);
+        m_pending[check.host].enqueue(check);
+    }
+
+    // let the caller finish setting up before the first results arrive
+    QTimer::singleShot(0, this, &LinkChecker::start_next);
+}
+
+void LinkChecker::cancel()
+{
+    const QSet<QNetworkReply *> replies = m_replies;
+    m_replies.clear();
+    for (QNetworkReply *reply : replies) {
+        reply->abort();
+    }
+
+    m_pending.clear();
+    m_hosts.clear();
+    m_active_per_host.clear();
+    m_active = 0;
+    m_result_callback = nullptr;
+    m_finished_callback = nullptr;
+}
+
+bool LinkChecker::is_running() const
+{
+    return m_active > 0 || !m_hosts.isEmpty();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QSet>
+#include <QStringList>
+
+#include <functional>
+
+struct LinkCheckResult
+{
+    enum Status
+    {
+        Ok,
+        Redirected,
+        Moved,
+        Broken,
+        Failed,
+    };
+
+    QString address;
+    Status status = Failed;
+    int http_status = 0;
+    QString location;
+    QString error;
+};
+
+class LinkChecker : public QObject
+{
+    struct Check
+    {
+        QString address;
+        QString host;
+        QUrl url;
+        bool use_get = false;
+        bool is_permanent = true;
+        int redirects = 0;
+    };
+
+    QNetworkAccessManager *m_manager = nullptr;
+    QHash<QString, QQueue<Check>> m_pending;
+    QStringList m_hosts;
+    QHash<QString, int> m_active_per_host;
+    QSet<QNetworkReply *> m_replies;
+    int m_active = 0;
+    int m_max_active = 8;
+    int m_max_per_host = 2;
+    int m_timeout = 15 * 1000;
+
+    QPointer<QObject> m_context;
+    std::function<void (const LinkCheckResult &)> m_result_callback;
+    std::function<void ()> m_finished_callback;
+
+    void start_next();
+    void send(const Check &check);
+    void handle_reply(QNetworkReply *reply, Check check);
+    void finish(const Check &check, const LinkCheckResult &result);
+public:
+    explicit LinkChecker(QObject *parent = nullptr);
+    ~LinkChecker();
+
+    void set_limits(int max_active, int max_per_host);
+    void set_timeout(int msecs);
+
+    void check(const QStringList &addresses, QObject *context, const std::function<void (const LinkCheckResult &)> &result_callback,
+               const std::function<void ()> &finished_callback);
+    void cancel();
+    bool is_running() const;
+};
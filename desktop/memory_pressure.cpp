@@ -0,0 +1,162 @@
+#include "memory_pressure.h"
+#include "task_manager.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+
+#include <algorithm>
+
+const int POLL_INTERVAL = 2000;
+const qint64 RESPONSE_COOLDOWN = 30 * 1000;
+
+const double MODERATE_SOME_AVG10 = 10;
+const double CRITICAL_SOME_AVG10 = 40;
+const double CRITICAL_FULL_AVG10 = 10;
+const double MODERATE_AVAILABLE_RATIO = 0.10;
+const double CRITICAL_AVAILABLE_RATIO = 0.05;
+
+static double pressure_avg10(const QByteArray &line)
+{
+    const int start = line.indexOf("avg10=");
+    if (start == -1)
+        return -1;
+
+    const int end = line.indexOf(' ', start);
+    return line.mid(start + 6, end - start - 6).toDouble();
+}
+
+static MemoryPressureMonitor::Level read_pressure_level()
+{
+    QFile file(QStringLiteral("/proc/pressure/memory"));
+    if (!file.open(QFile::ReadOnly))
+        return MemoryPressureMonitor::Normal;
+
+    double some = 0;
+    double full = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith("some"))
+            some = pressure_avg10(line);
+        else if (line.startsWith("full"))
+            full = pressure_avg10(line);
+    }
+
+    if (some >= CRITICAL_SOME_AVG10 || full >= CRITICAL_FULL_AVG10)
+        return MemoryPressureMonitor::Critical;
+    if (some >= MODERATE_SOME_AVG10)
+        return MemoryPressureMonitor::Moderate;
+    return MemoryPressureMonitor::Normal;
+}
+
+static MemoryPressureMonitor::Level read_available_level()
+{
+    QFile file(QStringLiteral("/proc/meminfo"));
+    if (!file.open(QFile::ReadOnly))
+        return MemoryPressureMonitor::Normal;
+
+    qint64 total = 0;
+    qint64 available = -1;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith("MemTotal:"))
+            total = line.mid(9).trimmed().split(' ').first().toLongLong();
+        else if (line.startsWith("MemAvailable:"))
+            available = line.mid(13).trimmed().split(' ').first().toLongLong();
+    }
+
+    if (total <= 0 || available < 0)
+        return MemoryPressureMonitor::Normal;
+
+    const double ratio = double(available) / total;
+    if (ratio < CRITICAL_AVAILABLE_RATIO)
+        return MemoryPressureMonitor::Critical;
+    if (ratio < MODERATE_AVAILABLE_RATIO)
+        return MemoryPressureMonitor::Moderate;
+    return MemoryPressureMonitor::Normal;
+}
+
+void MemoryPressureMonitor::poll()
+{
+    const Level level = read_level();
+    const bool is_rising = level > m_level;
+    m_level = level;
+
+    if (level == Normal)
+        return;
+
+    // pressure that holds on gets another response once the last one had time to show
+    if (is_rising || !m_last_response.isValid() || m_last_response.elapsed() >= RESPONSE_COOLDOWN)
+        respond(level);
+}
+
+void MemoryPressureMonitor::respond(Level level)
+{
+    m_last_response.start();
+
+    m_responders.erase(std::remove_if(m_responders.begin(), m_responders.end(), [] (const Responder &responder) {
+        return !responder.context;
+    }), m_responders.end());
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    const QVector<Responder> responders = m_responders;
+    for (const Responder &responder : responders) {
+        if (!responder.context || stage_level(responder.stage) > level)
+            continue;
+
+        // responders that cannot tell what they freed are measured by the resident size of the browser
+        const qint64 before = ProcessSampler::resident_bytes(pid);
+        qint64 reclaimed = responder.callback();
+        if (reclaimed < 0)
+            reclaimed = qMax<qint64>(0, before - ProcessSampler::resident_bytes(pid));
+
+        qDebug() << "Memory pressure" << level << responder.name << "reclaimed" << reclaimed << "bytes";
+    }
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_poll_timer = new QTimer(this);
+    m_poll_timer->setInterval(POLL_INTERVAL);
+    m_poll_timer->start();
+
+    connect(m_poll_timer, &QTimer::timeout, this, &MemoryPressureMonitor::poll);
+}
+
+MemoryPressureMonitor::Level MemoryPressureMonitor::level() const
+{
+    return m_level;
+}
+
+void MemoryPressureMonitor::add_responder(Stage stage, const QString &name, QObject *context, const std::function<qint64 ()> &callback)
+{
+    Responder responder;
+    responder.stage = stage;
+    responder.name = name;
+    responder.context = context;
+    responder.callback = callback;
+
+    // responders run by stage, and in the order they were added within one
+    auto it = std::upper_bound(m_responders.begin(), m_responders.end(), stage, [] (Stage stage, const Responder &other) {
+        return stage < other.stage;
+    });
+    m_responders.insert(it, responder);
+}
+
+MemoryPressureMonitor::Level MemoryPressureMonitor::read_level()
+{
+    // pressure stall information catches thrashing early, MemAvailable covers kernels without it
+    return qMax(read_pressure_level(), read_available_level());
+}
+
+MemoryPressureMonitor::Level MemoryPressureMonitor::stage_level(Stage stage)
+{
+    switch (stage) {
+    case DiscardTabs:
+    case ClearHttpCache:
+        return Critical;
+    default:
+        return Moderate;
+    }
+}
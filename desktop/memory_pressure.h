@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+class MemoryPressureMonitor : public QObject
+{
+public:
+    enum Level {
+        Normal,
+        Moderate,
+        Critical,
+    };
+
+    enum Stage {
+        DropCaches,
+        TrimModels,
+        TrimHeap,
+        FreezeTabs,
+        DiscardTabs,
+        ClearHttpCache,
+    };
+
+private:
+    struct Responder
+    {
+        Stage stage = DropCaches;
+        QString name;
+        QPointer<QObject> context;
+        std::function<qint64 ()> callback;
+    };
+
+    QVector<Responder> m_responders;
+    QTimer *m_poll_timer = nullptr;
+    QElapsedTimer m_last_response;
+    Level m_level = Normal;
+
+    void poll();
+    void respond(Level level);
+public:
+    explicit MemoryPressureMonitor(QObject *parent = nullptr);
+
+    Level level() const;
+    void add_responder(Stage stage, const QString &name, QObject *context, const std::function<qint64 ()> &callback);
+
+    static Level read_level();
+    static Level stage_level(Stage stage);
+};
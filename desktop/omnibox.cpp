@@ -0,0 +1,253 @@
+#include "browser.h"
+#include "completion.h"
+#include "omnibox.h"
+#include "preloader.h"
+#include "search_engine.h"
+#include "suggestions.h"
+
+#include <QHeaderView>
+#include <QKeyEvent>
+#include <QSettings>
+
+const int MAX_COMPLETIONS = 8;
+const int MAX_SUGGESTIONS = 5;
+const int SuggestionRole = Qt::UserRole + 1;
+const int ConfidenceRole = Qt::UserRole + 2;
+
+// same test the address bar uses to navigate instead of search
+static bool is_address(const QString &text)
+{
+    const QString trimmed = text.trimmed();
+    if (trimmed.contains(QLatin1Char(' ')))
+        return false;
+
+    const QUrl url = QUrl::fromUserInput(trimmed);
+    if (!url.isValid())
+        return false;
+
+    return !url.scheme().startsWith(QStringLiteral("http"))
+            || url.host() == QStringLiteral("localhost")
+            || url.host().contains(QLatin1Char('.'));
+}
+
+void Omnibox::update_completions(const QString &text, bool is_inline)
+{
+    m_inline_text.clear();
+    m_inline_destination.clear();
+
+    if (text.trimmed().isEmpty()) {
+        m_suggestion_fetcher->cancel();
+        browser->preloader()->discard();
+        hide_popup();
+        return;
+    }
+
+    // typed text only leaves the machine when it is meant as a search
+    const bool is_enabled = QSettings().value(QStringLiteral("browsing/search_suggestions"), true).toBool();
+    if (is_enabled && !browser->is_private() && !is_address(text)) {
+        const SearchEngine engine = browser->search_model()->default_engine();
+        m_suggestion_fetcher->fetch(engine.suggestion_url, text, this, [this] (const QStringList &suggestions) {
+            update_suggestions(suggestions);
+        });
+    } else {
+        m_suggestion_fetcher->cancel();
+        update_suggestions(QStringList());
+    }
+
+    const QVector<Completion> completions = browser->completer()->complete(text, MAX_COMPLETIONS);
+
+    for (int i = m_popup->topLevelItemCount() - 1; i >= 0; i--) {
+        if (!m_popup->topLevelItem(i)->data(0, SuggestionRole).toBool())
+            delete m_popup->takeTopLevelItem(i);
+    }
+
+    for (const Completion &completion : completions) {
+        QTreeWidgetItem *item = new QTreeWidgetItem;
+        m_popup->insertTopLevelItem(m_popup->topLevelItemCount() - suggestion_count(), item);
+        item->setIcon(0, QIcon::fromTheme(completion.is_bookmark ? QStringLiteral("bookmark-new") : QStringLiteral("appointment-new")));
+        item->setText(0, completion.title.isEmpty() ? completion.address : completion.title);
+        item->setText(1, completion.address);
+        item->setData(0, Qt::UserRole, completion.address);
+        item->setData(0, ConfidenceRole, completion.confidence);
+    }
+
+    m_popup->setCurrentItem(nullptr);
+    if (m_popup->topLevelItemCount() == 0)
+        hide_popup();
+    else
+        show_popup();
+
+    if (!is_inline) {
+        browser->preloader()->discard();
+        return;
+    }
+
+    QString destination;
+    const QString suffix = browser->completer()->inline_completion(text, &destination);
+    if (suffix.isEmpty()) {
+        browser->preloader()->discard();
+        return;
+    }
+
+    setText(text + suffix);
+    setSelection(text.length(), suffix.length());
+    m_inline_text = text + suffix;
+    m_inline_destination = destination;
+
+    // Enter goes to the inline destination, which is as likely as every completion below it
+    double confidence = 0;
+    for (const Completion &completion : completions) {
+        if (completion.address.startsWith(destination))
+            confidence += completion.confidence;
+    }
+    browser->preloader()->speculate(QUrl(destination), confidence);
+}
+
+void Omnibox::update_suggestions(const QStringList &suggestions)
+{
+    for (int i = m_popup->topLevelItemCount() - 1; i >= 0; i--) {
+        if (m_popup->topLevelItem(i)->data(0, SuggestionRole).toBool())
+            delete m_popup->takeTopLevelItem(i);
+    }
+
+    for (int i = 0; i < suggestions.count() && i < MAX_SUGGESTIONS; i++) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_popup);
+        item->setIcon(0, QIcon::fromTheme(QStringLiteral("edit-find")));
+        item->setText(0, suggestions.at(i));
+        item->setData(0, Qt::UserRole, suggestions.at(i));
+        item->setData(0, SuggestionRole, true);
+    }
+
+    if (m_popup->topLevelItemCount() == 0)
+        hide_popup();
+    else if (hasFocus())
+        show_popup();
+}
+
+void Omnibox::select_completion(int row)
+{
+    QTreeWidgetItem *item = m_popup->topLevelItem(row);
+    m_popup->setCurrentItem(item);
+
+    if (item)
+        setText(item->data(0, Qt::UserRole).toString());
+    else
+        setText(m_typed_text);
+
+    if (item && !item->data(0, SuggestionRole).toBool())
+        browser->preloader()->speculate(QUrl(text()), item->data(0, ConfidenceRole).toDouble());
+    else
+        browser->preloader()->discard();
+}
+
+void Omnibox::accept_completion(QTreeWidgetItem *item)
+{
+    setText(item->data(0, Qt::UserRole).toString());
+    hide_popup();
+    emit returnPressed();
+}
+
+void Omnibox::show_popup()
+{
+    const int rows = m_popup->topLevelItemCount();
+    m_popup->setColumnWidth(0, width() / 2);
+    m_popup->resize(width(), m_popup->sizeHintForRow(0) * rows + 2 * m_popup->frameWidth());
+    m_popup->move(mapToGlobal(QPoint(0, height())));
+    m_popup->show();
+}
+
+void Omnibox::hide_popup()
+{
+    m_popup->hide();
+}
+
+int Omnibox::suggestion_count() const
+{
+    int count = 0;
+    for (int i = 0; i < m_popup->topLevelItemCount(); i++) {
+        if (m_popup->topLevelItem(i)->data(0, SuggestionRole).toBool())
+            count++;
+    }
+    return count;
+}
+
+bool Omnibox::eventFilter(QObject *watched, QEvent *event)
+{
+    // the popup grabs the keyboard while it is open, typing still belongs to the address bar
+    if (watched == m_popup && event->type() == QEvent::KeyPress) {
+        keyPressEvent(static_cast<QKeyEvent *>(event));
+        return true;
+    }
+
+    return QLineEdit::eventFilter(watched, event);
+}
+
+void Omnibox::keyPressEvent(QKeyEvent *event)
+{
+    if (m_popup->isVisible()) {
+        const int rows = m_popup->topLevelItemCount();
+        const int row = m_popup->indexOfTopLevelItem(m_popup->currentItem());
+
+        switch (event->key()) {
+        case Qt::Key_Down:
+            select_completion(row + 1 < rows ? row + 1 : -1);
+            return;
+        case Qt::Key_Up:
+            select_completion(row == -1 ? rows - 1 : row - 1);
+            return;
+        case Qt::Key_Escape:
+            hide_popup();
+            setText(m_typed_text);
+            browser->preloader()->discard();
+            return;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            hide_popup();
+            break;
+        default:
+            break;
+        }
+    }
+
+    // an inline completion stands for the address it was cut from, scheme included
+    if ((event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) && !m_inline_destination.isEmpty() && text() == m_inline_text)
+        setText(m_inline_destination);
+
+    QLineEdit::keyPressEvent(event);
+}
+
+void Omnibox::focusOutEvent(QFocusEvent *event)
+{
+    if (event->reason() != Qt::PopupFocusReason) {
+        m_suggestion_fetcher->cancel();
+        hide_popup();
+    }
+
+    QLineEdit::focusOutEvent(event);
+}
+
+Omnibox::Omnibox(QWidget *parent)
+    : QLineEdit(parent)
+{
+    m_popup = new QTreeWidget(this);
+    m_popup->setWindowFlags(Qt::Popup);
+    m_popup->setFocusPolicy(Qt::NoFocus);
+    m_popup->setFocusProxy(this);
+    m_popup->setColumnCount(2);
+    m_popup->setHeaderHidden(true);
+    m_popup->setRootIsDecorated(false);
+    m_popup->setUniformRowHeights(true);
+    m_popup->header()->setStretchLastSection(true);
+    m_popup->installEventFilter(this);
+    m_popup->hide();
+
+    m_suggestion_fetcher = new SuggestionFetcher(this);
+
+    connect(m_popup, &QTreeWidget::itemClicked, this, &Omnibox::accept_completion);
+    connect(this, &QLineEdit::textEdited, this, [this] (const QString &text) {
+        // only complete inline while characters are being appended, never after a deletion
+        const bool is_inline = text.length() > m_typed_text.length() && text.startsWith(m_typed_text) && cursorPosition() == text.length();
+        m_typed_text = text;
+        update_completions(text, is_inline);
+    });
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QLineEdit>
+#include <QStringList>
+#include <QTreeWidget>
+
+class SuggestionFetcher;
+
+class Omnibox : public QLineEdit
+{
+    QTreeWidget *m_popup = nullptr;
+    SuggestionFetcher *m_suggestion_fetcher = nullptr;
+    QString m_typed_text;
+    QString m_inline_text;
+    QString m_inline_destination;
+
+    void update_completions(const QString &text, bool is_inline);
+    void update_suggestions(const QStringList &suggestions);
+    void select_completion(int row);
+    void accept_completion(QTreeWidgetItem *item);
+    void show_popup();
+    void hide_popup();
+    int suggestion_count() const;
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
+public:
+    explicit Omnibox(QWidget *parent = nullptr);
+};
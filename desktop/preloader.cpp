@@ -0,0 +1,165 @@
+#include "browser.h"
+#include "preloader.h"
+#include "webview.h"
+
+#include <QFile>
+#include <QNetworkConfigurationManager>
+#include <QSettings>
+
+const double PRELOAD_CONFIDENCE = 0.75;
+const int DISCARD_TIMEOUT = 30 * 1000;
+const qint64 MIN_AVAILABLE_MEMORY_KB = 512 * 1024;
+const qint64 RENDERER_MEMORY_BUDGET_KB = 256 * 1024;
+
+static qint64 read_proc_kb(const QString &path, const QByteArray &field)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+        return -1;
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (!line.startsWith(field))
+            continue;
+
+        const QList<QByteArray> parts = line.mid(field.length()).simplified().split(' ');
+        return parts.isEmpty() ? -1 : parts.at(0).toLongLong();
+    }
+
+    return -1;
+}
+
+static bool is_low_on_memory()
+{
+    const qint64 available = read_proc_kb(QStringLiteral("/proc/meminfo"), QByteArrayLiteral("MemAvailable:"));
+    return available != -1 && available < MIN_AVAILABLE_MEMORY_KB;
+}
+
+QT_WARNING_PUSH
+QT_WARNING_DISABLE_DEPRECATED
+static bool is_metered_connection(const QNetworkConfigurationManager *manager)
+{
+    // Qt 5 has no metered flag, treat cellular bearers as metered
+    const QList<QNetworkConfiguration> configurations = manager->allConfigurations(QNetworkConfiguration::Active);
+    for (const QNetworkConfiguration &configuration : configurations) {
+        switch (configuration.bearerTypeFamily()) {
+        case QNetworkConfiguration::Bearer2G:
+        case QNetworkConfiguration::Bearer3G:
+        case QNetworkConfiguration::Bearer4G:
+            return true;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+void Preloader::watch_connection()
+{
+    // bearers are only enumerated again when they change, not on every keystroke
+    QNetworkConfigurationManager *manager = new QNetworkConfigurationManager(this);
+    const auto update = [this, manager] {
+        m_is_metered = is_metered_connection(manager);
+    };
+
+    connect(manager, &QNetworkConfigurationManager::configurationAdded, this, update);
+    connect(manager, &QNetworkConfigurationManager::configurationRemoved, this, update);
+    connect(manager, &QNetworkConfigurationManager::configurationChanged, this, update);
+    connect(manager, &QNetworkConfigurationManager::onlineStateChanged, this, update);
+    update();
+}
+QT_WARNING_POP
+
+bool Preloader::can_speculate() const
+{
+    QSettings settings;
+    if (!settings.value(QStringLiteral("browsing/preload_pages"), true).toBool())
+        return false;
+
+    return !m_is_metered && !is_low_on_memory();
+}
+
+void Preloader::check_memory_budget(bool ok)
+{
+    if (!ok) {
+        discard();
+        return;
+    }
+
+    const QString path = QStringLiteral("/proc/%1/status").arg(m_page->renderProcessPid());
+    const qint64 resident = read_proc_kb(path, QByteArrayLiteral("VmRSS:"));
+    if (resident > RENDERER_MEMORY_BUDGET_KB)
+        discard();
+}
+
+Preloader::Preloader(QObject *parent)
+    : QObject(parent)
+{
+    m_discard_timer = new QTimer(this);
+    m_discard_timer->setSingleShot(true);
+    m_discard_timer->setInterval(DISCARD_TIMEOUT);
+
+    connect(m_discard_timer, &QTimer::timeout, this, &Preloader::discard);
+
+    watch_connection();
+}
+
+Preloader::~Preloader()
+{
+    delete m_page;
+}
+
+void Preloader::speculate(const QUrl &url, double confidence)
+{
+    const bool is_web = url.scheme() == QStringLiteral("http") || url.scheme() == QStringLiteral("https");
+    if (!is_web || confidence < PRELOAD_CONFIDENCE) {
+        discard();
+        return;
+    }
+
+    if (m_page && url == m_url) {
+        m_discard_timer->start();
+        return;
+    }
+
+    discard();
+    if (!can_speculate())
+        return;
+
+    m_url = url;
+    m_page = new WebPage(browser->web_profile(), this);
+    m_page->setAudioMuted(true);
+    connect(m_page, &QWebEnginePage::loadFinished, this, &Preloader::check_memory_budget);
+
+    m_page->load(m_url);
+    m_discard_timer->start();
+}
+
+WebPage *Preloader::take(const QUrl &url)
+{
+    if (!m_page || url.adjusted(QUrl::StripTrailingSlash) != m_url.adjusted(QUrl::StripTrailingSlash)) {
+        discard();
+        return nullptr;
+    }
+
+    WebPage *page = m_page;
+    m_page = nullptr;
+    m_url.clear();
+    m_discard_timer->stop();
+
+    disconnect(page, nullptr, this, nullptr);
+    page->setAudioMuted(false);
+    return page;
+}
+
+void Preloader::discard()
+{
+    m_discard_timer->stop();
+    m_url.clear();
+
+    // may be called from one of the page's own signals
+    if (m_page)
+        m_page->deleteLater();
+    m_page = nullptr;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+
+class WebPage;
+
+class Preloader : public QObject
+{
+    WebPage *m_page = nullptr;
+    QUrl m_url;
+    QTimer *m_discard_timer = nullptr;
+    bool m_is_metered = false;
+
+    void watch_connection();
+    bool can_speculate() const;
+    void check_memory_budget(bool ok);
+public:
+    explicit Preloader(QObject *parent = nullptr);
+    ~Preloader();
+
+    void speculate(const QUrl &url, double confidence);
+    WebPage *take(const QUrl &url);
+    void discard();
+};
@@ -0,0 +1,172 @@
+#include "browser_window.h"
+#include "renderer_scheduler.h"
+#include "tab.h"
+#include "webview.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QSet>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const int BACKGROUND_NICE = 10;
+
+#ifdef Q_OS_LINUX
+const int IOPRIO_WHO_PROCESS = 1;
+const int IOPRIO_CLASS_SHIFT = 13;
+const int IOPRIO_CLASS_BE = 2;
+const int IOPRIO_BACKGROUND = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 7;
+
+// priorities on linux belong to threads, so every thread of a renderer is changed
+static QVector<qint64> threads(qint64 pid)
+{
+    QVector<qint64> tids;
+    const QStringList entries = QDir(QStringLiteral("/proc/%1/task").arg(pid)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries) {
+        tids.append(entry.toLongLong());
+    }
+    return tids;
+}
+
+static bool can_restore_nice(int nice)
+{
+    if (geteuid() == 0)
+        return true;
+
+    // without privileges a nice value can only be lowered again down to 20 - RLIMIT_NICE
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NICE, &limit) != 0)
+        return false;
+
+    return limit.rlim_cur == RLIM_INFINITY || nice >= 20 - int(limit.rlim_cur);
+}
+#endif
+
+void RendererScheduler::update()
+{
+    QSet<qint64> foreground;
+    QSet<qint64> background;
+    for (QWidget *widget : QApplication::topLevelWidgets()) {
+        BrowserWindow *window = dynamic_cast<BrowserWindow *>(widget);
+        if (!window)
+            continue;
+
+        const QList<Tab *> tabs = window->tabs();
+        for (int i = 0; i < tabs.count(); i++) {
+            WebTab *tab = dynamic_cast<WebTab *>(tabs.at(i));
+            if (!tab || !tab->has_webview())
+                continue;
+
+            const qint64 pid = tab->webview()->page()->renderProcessPid();
+            if (pid <= 0)
+                continue;
+
+            if (i == window->current_index())
+                foreground.insert(pid);
+            else
+                background.insert(pid);
+        }
+    }
+
+    // a renderer shared with any current tab keeps its normal priority
+    background.subtract(foreground);
+
+    for (auto it = m_demoted.begin(); it != m_demoted.end();) {
+        if (background.contains(it.key())) {
+            ++it;
+            continue;
+        }
+
+        restore(it.key(), it.value());
+        it = m_demoted.erase(it);
+    }
+
+    for (qint64 pid : qAsConst(background)) {
+        auto it = m_demoted.constFind(pid);
+        if (it != m_demoted.constEnd()) {
+            // threads started since the last update inherit nothing from the demotion
+            apply(pid, it.value());
+            continue;
+        }
+
+        Priority priority;
+        if (demote(pid, &priority))
+            m_demoted.insert(pid, priority);
+    }
+}
+
+bool RendererScheduler::demote(qint64 pid, Priority *priority) const
+{
+#ifdef Q_OS_LINUX
+    errno = 0;
+    priority->nice = getpriority(PRIO_PROCESS, id_t(pid));
+    if (errno != 0)
+        return false;
+
+    priority->io_priority = qMax(0L, syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, pid_t(pid)));
+    priority->is_nice_changed = priority->nice < BACKGROUND_NICE && can_restore_nice(priority->nice);
+
+    apply(pid, *priority);
+    return true;
+#else
+    Q_UNUSED(pid)
+    Q_UNUSED(priority)
+    return false;
+#endif
+}
+
+void RendererScheduler::apply(qint64 pid, const Priority &priority) const
+{
+#ifdef Q_OS_LINUX
+    for (qint64 tid : threads(pid)) {
+        if (priority.is_nice_changed)
+            setpriority(PRIO_PROCESS, id_t(tid), BACKGROUND_NICE);
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pid_t(tid), IOPRIO_BACKGROUND);
+    }
+#else
+    Q_UNUSED(pid)
+    Q_UNUSED(priority)
+#endif
+}
+
+void RendererScheduler::restore(qint64 pid, const Priority &priority) const
+{
+#ifdef Q_OS_LINUX
+    for (qint64 tid : threads(pid)) {
+        if (priority.is_nice_changed)
+            setpriority(PRIO_PROCESS, id_t(tid), priority.nice);
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pid_t(tid), priority.io_priority);
+    }
+#else
+    Q_UNUSED(pid)
+    Q_UNUSED(priority)
+#endif
+}
+
+RendererScheduler::RendererScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_update_timer = new QTimer(this);
+    // updates run on the next pass of the event loop, so a tab switch is not held back by them
+    m_update_timer->setSingleShot(true);
+
+    connect(m_update_timer, &QTimer::timeout, this, &RendererScheduler::update);
+}
+
+RendererScheduler::~RendererScheduler()
+{
+    for (auto it = m_demoted.constBegin(); it != m_demoted.constEnd(); ++it) {
+        restore(it.key(), it.value());
+    }
+}
+
+void RendererScheduler::schedule_update()
+{
+    if (!m_update_timer->isActive())
+        m_update_timer->start();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+class RendererScheduler : public QObject
+{
+    struct Priority
+    {
+        int nice = 0;
+        int io_priority = 0;
+        bool is_nice_changed = false;
+    };
+
+    QHash<qint64, Priority> m_demoted;
+    QTimer *m_update_timer = nullptr;
+
+    void update();
+    bool demote(qint64 pid, Priority *priority) const;
+    void apply(qint64 pid, const Priority &priority) const;
+    void restore(qint64 pid, const Priority &priority) const;
+public:
+    explicit RendererScheduler(QObject *parent = nullptr);
+    ~RendererScheduler();
+
+    void schedule_update();
+};
@@ -7,14 +7,40 @@
 #include <QMessageBox>
 #include <QPushButton>
 #include <QSettings>
+#include <QUrl>
 #include <QVBoxLayout>
 
+// Shortcuts typed as "!w terms" like DuckDuckGo bangs, the "!" keeps them from catching plain searches
+static const QHash<QString, QString> &builtin_bangs()
+{
+    static const QHash<QString, QString> bangs {
+        { QStringLiteral("ecosia"), QStringLiteral("https://www.ecosia.org/search?tt=crusta&q={searchTerms}") },
+        { QStringLiteral("g"), QStringLiteral("https://www.google.com/search?q={searchTerms}") },
+        { QStringLiteral("ddg"), QStringLiteral("https://duckduckgo.com/?q={searchTerms}") },
+        { QStringLiteral("w"), QStringLiteral("https://en.wikipedia.org/wiki/Special:Search?search={searchTerms}") },
+        { QStringLiteral("yt"), QStringLiteral("https://www.youtube.com/results?search_query={searchTerms}") },
+        { QStringLiteral("gh"), QStringLiteral("https://github.com/search?q={searchTerms}") },
+        { QStringLiteral("so"), QStringLiteral("https://stackoverflow.com/search?q={searchTerms}") },
+        { QStringLiteral("osm"), QStringLiteral("https://www.openstreetmap.org/search?query={searchTerms}") },
+    };
+    return bangs;
+}
+
+void SearchModel::update_keywords()
+{
+    m_keywords.clear();
+    for (const SearchEngine &engine : qAsConst(m_engines)) {
+        if (!engine.keyword.isEmpty())
+            m_keywords.insert(engine.keyword, engine.query_url);
+    }
+}
+
 SearchModel::SearchModel(QObject *parent)
     : QAbstractTableModel(parent)
 {
     m_engines << SearchEngine { QStringLiteral("Ecosia"), QStringLiteral("The search engine that plants trees"), QStringLiteral("https://www.ecosia.org/search?tt=crusta&q={searchTerms}"), QStringLiteral("https://ac.ecosia.org/autocomplete?tt=crusta&q={searchTerms}") };
     m_engines << SearchEngine { QStringLiteral("Google"), QStringLiteral("Google Search"), QStringLiteral("https://www.google.com/search?q={searchTerms}"), QStringLiteral("https://www.google.com/complete/search?q={searchTerms}") };
-    m_engines << SearchEngine { QStringLiteral("DuckDuckGo"), QStringLiteral("Search DuckDuckGo"), QStringLiteral("https://duckduckgo.com/?q={searchTerms}"), QStringLiteral("https://duckduckgo.com/ac/?q={searchTerms}&amp;type=list") };
+    m_engines << SearchEngine { QStringLiteral("DuckDuckGo"), QStringLiteral("Search DuckDuckGo"), QStringLiteral("https://duckduckgo.com/?q={searchTerms}"), QStringLiteral("https://duckduckgo.com/ac/?q={searchTerms}&type=list") };
 
     qRegisterMetaType<SearchEngine>();
     qRegisterMetaTypeStreamOperators<SearchEngine>();
@@ -26,6 +52,13 @@ SearchModel::SearchModel(QObject *parent)
     }
 
     m_default_index = settings.value(QStringLiteral("default_search_engine"), 0).toInt();
+
+    // engines only get a keyword the user picked, a default single letter would hijack searches like "e coli"
+    const QVariantMap keywords = settings.value(QStringLiteral("search_keywords")).toMap();
+    for (SearchEngine &engine : m_engines) {
+        engine.keyword = keywords.value(engine.name).toString();
+    }
+    update_keywords();
 }
 
 int SearchModel::rowCount(const QModelIndex &parent) const
@@ -35,7 +68,7 @@ int SearchModel::rowCount(const QModelIndex &parent) const
 
 int SearchModel::columnCount(const QModelIndex &parent) const
 {
-    return parent.isValid() ? 0 : 2;
+    return parent.isValid() ? 0 : 3;
 }
 
 QVariant SearchModel::data(const QModelIndex &index, int role) const
@@ -50,6 +83,7 @@ QVariant SearchModel::data(const QModelIndex &index, int role) const
         switch (index.column()) {
         case 0: return engine.name;
         case 1: return engine.description;
+        case 2: return engine.keyword;
         default: break;
         }
     case Qt::FontRole:
@@ -69,12 +103,30 @@ QVariant SearchModel::headerData(int section, Qt::Orientation orientation, int r
         switch (section) {
         case 0: return QStringLiteral("Name");
         case 1: return QStringLiteral("Description");
+        case 2: return QStringLiteral("Keyword");
         }
     }
 
     return QAbstractTableModel::headerData(section, orientation, role);
 }
 
+Qt::ItemFlags SearchModel::flags(const QModelIndex &index) const
+{
+    if (index.column() == 2)
+        return QAbstractTableModel::flags(index) | Qt::ItemIsEditable;
+
+    return QAbstractTableModel::flags(index);
+}
+
+bool SearchModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || index.column() != 2)
+        return false;
+
+    set_keyword(index.row(), value.toString());
+    return true;
+}
+
 SearchEngine SearchModel::default_engine() const
 {
     return m_engines.at(m_default_index);
@@ -87,6 +139,75 @@ void SearchModel::set_default(int index)
     settings.setValue(QStringLiteral("default_search_engine"), index);
 }
 
+void SearchModel::set_keyword(int index, const QString &keyword)
+{
+    if (index < 0 || index >= m_engines.count())
+        return;
+
+    QString normalized = keyword.trimmed().toLower();
+    if (normalized.startsWith(QLatin1Char('!')))
+        normalized.remove(0, 1);
+
+    QSettings settings;
+    QVariantMap keywords = settings.value(QStringLiteral("search_keywords")).toMap();
+
+    // a keyword points at one engine, the engine that had it before gives it up
+    for (int i = 0; i < m_engines.count(); i++) {
+        if (i == index || normalized.isEmpty() || m_engines.at(i).keyword != normalized)
+            continue;
+
+        m_engines[i].keyword.clear();
+        keywords.insert(m_engines.at(i).name, QString());
+        emit dataChanged(this->index(i, 2), this->index(i, 2));
+    }
+
+    m_engines[index].keyword = normalized;
+    update_keywords();
+
+    keywords.insert(m_engines.at(index).name, normalized);
+    settings.setValue(QStringLiteral("search_keywords"), keywords);
+
+    emit dataChanged(this->index(index, 2), this->index(index, 2));
+}
+
+QString SearchModel::resolve_keyword(const QString &text) const
+{
+    const QString trimmed = text.trimmed();
+    const int space = trimmed.indexOf(QLatin1Char(' '));
+
+    QString keyword;
+    QString terms;
+    bool is_bang = true;
+    if (trimmed.startsWith(QLatin1Char('!'))) {
+        keyword = trimmed.mid(1, space == -1 ? -1 : space - 1);
+        terms = space == -1 ? QString() : trimmed.mid(space + 1).trimmed();
+    } else if (space != -1 && trimmed.lastIndexOf(QLatin1String(" !")) > 0) {
+        const int bang = trimmed.lastIndexOf(QLatin1String(" !"));
+        keyword = trimmed.mid(bang + 2);
+        terms = trimmed.left(bang).trimmed();
+        if (keyword.contains(QLatin1Char(' ')))
+            return QString();
+    } else if (space != -1) {
+        keyword = trimmed.left(space);
+        is_bang = false;
+        terms = trimmed.mid(space + 1).trimmed();
+        if (terms.isEmpty())
+            return QString();
+    } else {
+        return QString();
+    }
+
+    // built-in bangs only apply when typed with a "!", so "so what" stays a plain search
+    keyword = keyword.toLower();
+    QString address = m_keywords.value(keyword);
+    if (address.isEmpty() && is_bang)
+        address = builtin_bangs().value(keyword);
+    if (address.isEmpty())
+        return QString();
+
+    return address.replace(QStringLiteral("{searchTerms}"), QString::fromUtf8(QUrl::toPercentEncoding(terms)));
+}
+
 void SearchModel::add_engine(SearchEngine engine)
 {
     int row = m_engines.count();
@@ -100,6 +221,9 @@ void SearchModel::add_engine(SearchEngine engine)
     var.setValue(engine);
     engines << var;
     settings.setValue(QStringLiteral("search_engines"), engines);
+
+    if (!engine.keyword.isEmpty())
+        set_keyword(row, engine.keyword);
 }
 
 void SearchModel::remove_engine(QModelIndex index)
@@ -111,9 +235,14 @@ void SearchModel::remove_engine(QModelIndex index)
     beginRemoveRows(QModelIndex(), row, row);
     m_engines.remove(row);
     endRemoveRows();
+    update_keywords();
 
     QSettings settings;
-    QList<QVariant> engines = settings.value(QStringLiteral("searchengines")).toList();
+    QVariantMap keywords = settings.value(QStringLiteral("search_keywords")).toMap();
+    keywords.remove(engine.name);
+    settings.setValue(QStringLiteral("search_keywords"), keywords);
+
+    QList<QVariant> engines = settings.value(QStringLiteral("search_engines")).toList();
     QMutableListIterator<QVariant> it(engines);
     while (it.hasNext()) {
         QVariant var = it.next();
@@ -124,7 +253,7 @@ void SearchModel::remove_engine(QModelIndex index)
         }
     }
 
-    settings.setValue(QStringLiteral("searchengines"), engines);
+    settings.setValue(QStringLiteral("search_engines"), engines);
 }
 
 SearchWidget::SearchWidget(QWidget *parent)
@@ -173,6 +302,10 @@ SearchWidget::SearchWidget(QWidget *parent)
         suggestion_url->setPlaceholderText(QStringLiteral("Autocomplete url in opensearch format"));
         vbox->addWidget(suggestion_url);
 
+        QLineEdit *keyword = new QLineEdit;
+        keyword->setPlaceholderText(QStringLiteral("Keyword, e.g. \"wiki\" to search with \"wiki terms\" or \"!wiki terms\""));
+        vbox->addWidget(keyword);
+
         QPushButton *save = new QPushButton(QStringLiteral("Add"));
         QPushButton *cancel = new QPushButton(QStringLiteral("Cancel"));
 
@@ -186,7 +319,7 @@ SearchWidget::SearchWidget(QWidget *parent)
         sd->open();
 
         connect(save, &QPushButton::clicked, [=] {
-            SearchEngine engine = { name->text(), description->text(), query_url->text(), suggestion_url->text() };
+            SearchEngine engine = { name->text(), description->text(), query_url->text(), suggestion_url->text(), keyword->text() };
             browser->search_model()->add_engine(engine);
             sd->close();
         });
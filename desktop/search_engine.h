@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QTreeView>
 #include <QWidget>
 
@@ -10,6 +11,7 @@ struct SearchEngine
     QString description;
     QString query_url;
     QString suggestion_url;
+    QString keyword;
 
     bool operator==(const SearchEngine &other)
     {
@@ -37,7 +39,10 @@ Q_DECLARE_METATYPE(SearchEngine)
 class SearchModel : public QAbstractTableModel
 {
     QVector<SearchEngine> m_engines;
+    QHash<QString, QString> m_keywords;
     int m_default_index = 0;
+
+    void update_keywords();
 public:
     explicit SearchModel(QObject *parent = nullptr);
 
@@ -45,8 +50,12 @@ public:
     int columnCount(const QModelIndex &parent) const;
     QVariant data(const QModelIndex &index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role);
 
     SearchEngine default_engine() const;
+    void set_keyword(int index, const QString &keyword);
+    QString resolve_keyword(const QString &text) const;
     void set_default(int index);
 
     void add_engine(SearchEngine engine);
@@ -0,0 +1,307 @@
+#include "browser_window.h"
+#include "session.h"
+#include "tab.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QIcon>
+#include <QSaveFile>
+#include <QThread>
+#include <QUrl>
+#include <QVector>
+
+const quint32 SESSION_MAGIC = 0x43535331;
+const quint32 SESSION_VERSION = 1;
+const int SAVE_DELAY = 2000;
+
+struct RestoredTab
+{
+    QUrl url;
+    QString title;
+    QIcon icon;
+    bool is_pinned = false;
+    QByteArray history;
+};
+
+SessionWindow SessionManager::serialize_window(BrowserWindow *window)
+{
+    SessionWindow session_window;
+    session_window.geometry = window->saveGeometry();
+    session_window.state = window->saveState();
+
+    const QList<Tab *> tabs = window->tabs();
+    for (int i = 0; i < tabs.count(); i++) {
+        WebTab *tab = dynamic_cast<WebTab *>(tabs.at(i));
+        if (!tab)
+            continue;
+        if (i == window->current_index())
+            session_window.current_index = session_window.tabs.count();
+        session_window.tabs.append(tab_state(tab));
+    }
+    return session_window;
+}
+
+QByteArray SessionManager::serialize()
+{
+    QVector<SessionWindow> windows;
+    for (const QPointer<QWidget> &window : qAsConst(m_windows)) {
+        if (window)
+            windows.append(m_serializer(window));
+    }
+    return encode(windows);
+}
+
+QByteArray SessionManager::encode(const QVector<SessionWindow> &windows)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    stream << SESSION_MAGIC << SESSION_VERSION << quint32(windows.count());
+    for (const SessionWindow &window : windows) {
+        stream << window.geometry << window.state << window.current_index << quint32(window.tabs.count());
+        for (const QByteArray &tab : window.tabs) {
+            stream << tab;
+        }
+    }
+    return data;
+}
+
+QVector<SessionWindow> SessionManager::decode(const QByteArray &data, bool *ok)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    QVector<SessionWindow> windows;
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 window_count = 0;
+    stream >> magic >> version >> window_count;
+    if (magic != SESSION_MAGIC || version != SESSION_VERSION) {
+        if (ok)
+            *ok = false;
+        return windows;
+    }
+
+    for (quint32 i = 0; i < window_count && stream.status() == QDataStream::Ok; i++) {
+        SessionWindow window;
+        quint32 tab_count = 0;
+        stream >> window.geometry >> window.state >> window.current_index >> tab_count;
+
+        for (quint32 j = 0; j < tab_count && stream.status() == QDataStream::Ok; j++) {
+            QByteArray tab;
+            stream >> tab;
+            window.tabs.append(tab);
+        }
+        windows.append(window);
+    }
+
+    if (ok)
+        *ok = stream.status() == QDataStream::Ok;
+    return windows;
+}
+
+QByteArray SessionManager::tab_state(WebTab *tab)
+{
+    // only tabs that changed since the last save are serialized again
+    auto it = m_tab_states.find(tab);
+    if (it != m_tab_states.end() && !it.value().isEmpty())
+        return it.value();
+
+    if (it == m_tab_states.end()) {
+        it = m_tab_states.insert(tab, QByteArray());
+        connect(tab, &QObject::destroyed, this, [this, tab] {
+            m_tab_states.remove(tab);
+        });
+    }
+
+    QDataStream stream(&it.value(), QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << tab->url() << tab->title() << tab->icon() << tab->is_pinned() << tab->history_state();
+    return it.value();
+}
+
+SessionManager::SessionManager(const QString &directory, QObject *parent)
+    : QObject(parent)
+{
+    const QDir dir(directory);
+    dir.mkpath(QStringLiteral("."));
+    m_path = dir.absoluteFilePath(QStringLiteral("session.dat"));
+
+    m_thread = new QThread(this);
+    m_thread->setObjectName(QStringLiteral("SessionManager"));
+
+    m_writer = new QObject;
+    m_writer->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_writer, &QObject::deleteLater);
+    m_thread->start();
+
+    m_save_timer = new QTimer(this);
+    m_save_timer->setSingleShot(true);
+    m_save_timer->setInterval(SAVE_DELAY);
+    connect(m_save_timer, &QTimer::timeout, this, &SessionManager::save);
+
+    m_serializer = [this] (QWidget *window) {
+        BrowserWindow *browser_window = dynamic_cast<BrowserWindow *>(window);
+        return browser_window ? serialize_window(browser_window) : SessionWindow();
+    };
+
+    // the last close may not get another turn of the event loop before the application quits
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &SessionManager::finish_close);
+}
+
+SessionManager::~SessionManager()
+{
+    // let queued writes reach the disk before the writer thread stops
+    wait();
+    m_thread->quit();
+    m_thread->wait();
+}
+
+QString SessionManager::path() const
+{
+    return m_path;
+}
+
+void SessionManager::set_serializer(const std::function<SessionWindow (QWidget *)> &serializer)
+{
+    m_serializer = serializer;
+}
+
+bool SessionManager::restore()
+{
+    QFile file(m_path);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    bool ok = false;
+    const QVector<SessionWindow> windows = decode(file.readAll(), &ok);
+    if (!ok) {
+        qDebug() << "Error reading session" << m_path;
+        return false;
+    }
+
+    bool is_restored = false;
+    for (const SessionWindow &window : windows) {
+        QVector<RestoredTab> tabs;
+        for (const QByteArray &state : window.tabs) {
+            RestoredTab tab;
+            QDataStream stream(state);
+            stream.setVersion(QDataStream::Qt_5_12);
+            stream >> tab.url >> tab.title >> tab.icon >> tab.is_pinned >> tab.history;
+            if (stream.status() == QDataStream::Ok)
+                tabs.append(tab);
+        }
+
+        if (tabs.isEmpty())
+            continue;
+
+        BrowserWindow *browser_window = new BrowserWindow;
+        for (const RestoredTab &tab : qAsConst(tabs)) {
+            WebTab *web_tab = browser_window->add_background_tab(tab.url, tab.title, tab.icon);
+            web_tab->set_pinned(tab.is_pinned);
+            web_tab->set_history_state(tab.history);
+        }
+
+        // drop the blank tab every window starts with, only the current tab gets a view when shown
+        browser_window->remove_tab(0);
+        browser_window->set_current_index(qBound(0, int(window.current_index), tabs.count() - 1));
+        browser_window->restoreGeometry(window.geometry);
+        browser_window->restoreState(window.state);
+        browser_window->show();
+        is_restored = true;
+    }
+
+    return is_restored;
+}
+
+void SessionManager::add_window(QWidget *window)
+{
+    m_windows.append(window);
+    schedule_save();
+}
+
+void SessionManager::close_window()
+{
+    // "Close All Windows" closes one window at a time, so the snapshot is taken before the first of them goes
+    if (m_closing_snapshot.isEmpty())
+        m_closing_snapshot = serialize();
+
+    QTimer::singleShot(0, this, &SessionManager::finish_close);
+}
+
+void SessionManager::finish_close()
+{
+    if (m_closing_snapshot.isEmpty())
+        return;
+
+    // a window leaves the session only once its close went through and another window stays open
+    bool has_open_window = false;
+    for (const QPointer<QWidget> &window : qAsConst(m_windows)) {
+        if (window && window->isVisible())
+            has_open_window = true;
+    }
+
+    if (has_open_window) {
+        m_closing_snapshot.clear();
+        for (int i = m_windows.count() - 1; i >= 0; i--) {
+            if (!m_windows.at(i) || !m_windows.at(i)->isVisible())
+                m_windows.removeAt(i);
+        }
+        schedule_save();
+        return;
+    }
+
+    // closing the last windows ends the session, which is kept for the next start
+    m_save_timer->stop();
+    write(m_closing_snapshot);
+    m_closing_snapshot.clear();
+    m_is_closing = true;
+}
+
+void SessionManager::tab_changed(WebTab *tab)
+{
+    auto it = m_tab_states.find(tab);
+    if (it != m_tab_states.end())
+        it.value().clear();
+
+    schedule_save();
+}
+
+void SessionManager::schedule_save()
+{
+    if (m_is_closing || m_save_timer->isActive())
+        return;
+
+    m_save_timer->start();
+}
+
+void SessionManager::save()
+{
+    m_save_timer->stop();
+    write(serialize());
+}
+
+void SessionManager::write(const QByteArray &data)
+{
+    const QString path = m_path;
+    QMetaObject::invokeMethod(m_writer, [path, data] {
+        QSaveFile file(path);
+        if (!file.open(QFile::WriteOnly)) {
+            qDebug() << "Error writing session" << file.errorString();
+            return;
+        }
+
+        file.write(data);
+        if (!file.commit())
+            qDebug() << "Error writing session" << file.errorString();
+    });
+}
+
+void SessionManager::wait()
+{
+    QMetaObject::invokeMethod(m_writer, [] {}, Qt::BlockingQueuedConnection);
+}
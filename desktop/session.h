@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+class BrowserWindow;
+class QThread;
+class QWidget;
+class WebTab;
+
+struct SessionWindow
+{
+    QByteArray geometry;
+    QByteArray state;
+    qint32 current_index = 0;
+    QVector<QByteArray> tabs;
+};
+
+class SessionManager : public QObject
+{
+    QString m_path;
+    QList<QPointer<QWidget>> m_windows;
+    QHash<WebTab *, QByteArray> m_tab_states;
+    std::function<SessionWindow (QWidget *)> m_serializer;
+    QByteArray m_closing_snapshot;
+    bool m_is_closing = false;
+
+    QThread *m_thread = nullptr;
+    QObject *m_writer = nullptr;
+    QTimer *m_save_timer = nullptr;
+
+    SessionWindow serialize_window(BrowserWindow *window);
+    QByteArray serialize();
+    QByteArray tab_state(WebTab *tab);
+    void write(const QByteArray &data);
+    void finish_close();
+public:
+    explicit SessionManager(const QString &directory, QObject *parent = nullptr);
+    ~SessionManager();
+
+    static QByteArray encode(const QVector<SessionWindow> &windows);
+    static QVector<SessionWindow> decode(const QByteArray &data, bool *ok = nullptr);
+
+    QString path() const;
+    void set_serializer(const std::function<SessionWindow (QWidget *)> &serializer);
+
+    bool restore();
+    void add_window(QWidget *window);
+    void close_window();
+    void tab_changed(WebTab *tab);
+    void schedule_save();
+    void save();
+    void wait();
+};
@@ -0,0 +1,177 @@
+#include "suggestions.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkRequest>
+#include <QUrl>
+#include <QXmlStreamReader>
+
+const int DEBOUNCE_INTERVAL = 150;
+const int CACHE_TTL = 60;
+const int MAX_CACHED = 256;
+const qint64 MAX_RESPONSE_SIZE = 64 * 1024;
+
+static QString suggestion_text(const QJsonValue &value)
+{
+    if (value.isString())
+        return value.toString();
+
+    const QJsonObject object = value.toObject();
+    for (const QString &key : { QStringLiteral("phrase"), QStringLiteral("value"), QStringLiteral("suggestion") }) {
+        if (object.value(key).isString())
+            return object.value(key).toString();
+    }
+
+    return QString();
+}
+
+void SuggestionFetcher::start()
+{
+    if (!m_manager)
+        m_manager = new QNetworkAccessManager(this);
+
+    QString address = m_url;
+    address.replace(QStringLiteral("{searchTerms}"), QString::fromUtf8(QUrl::toPercentEncoding(m_text)));
+
+    const QUrl url(address);
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    QNetworkReply *reply = m_manager->get(request);
+    m_reply = reply;
+
+    const QString key = m_url + QLatin1Char('\n') + m_text;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key] {
+        reply->deleteLater();
+        if (reply != m_reply)
+            return;
+
+        m_reply = nullptr;
+        if (reply->error() != QNetworkReply::NoError)
+            return;
+
+        const QStringList suggestions = parse(reply->read(MAX_RESPONSE_SIZE));
+        cache(key, suggestions);
+
+        if (m_context && m_callback)
+            m_callback(suggestions);
+    });
+}
+
+void SuggestionFetcher::abort()
+{
+    if (!m_reply)
+        return;
+
+    QNetworkReply *reply = m_reply;
+    m_reply = nullptr;
+    reply->abort();
+}
+
+void SuggestionFetcher::cache(const QString &key, const QStringList &suggestions)
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+
+    if (m_cache.count() >= MAX_CACHED) {
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            if (it->expires <= now)
+                it = m_cache.erase(it);
+            else
+                ++it;
+        }
+    }
+    if (m_cache.count() >= MAX_CACHED)
+        m_cache.clear();
+
+    m_cache.insert(key, CachedSuggestions { suggestions, now.addSecs(CACHE_TTL) });
+}
+
+SuggestionFetcher::SuggestionFetcher(QObject *parent)
+    : QObject(parent)
+{
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(DEBOUNCE_INTERVAL);
+    connect(m_timer, &QTimer::timeout, this, &SuggestionFetcher::start);
+}
+
+SuggestionFetcher::~SuggestionFetcher()
+{
+    abort();
+}
+
+void SuggestionFetcher::fetch(const QString &suggestion_url, const QString &text, QObject *context, const std::function<void (const QStringList &)> &callback)
+{
+    const QString trimmed = text.trimmed();
+    if (suggestion_url.isEmpty() || trimmed.isEmpty()) {
+        cancel();
+        return;
+    }
+
+    const QString key = suggestion_url + QLatin1Char('\n') + trimmed;
+    auto it = m_cache.constFind(key);
+    if (it != m_cache.constEnd() && it->expires > QDateTime::currentDateTimeUtc()) {
+        cancel();
+        callback(it->suggestions);
+        return;
+    }
+
+    // a newer keystroke makes the request in flight useless
+    abort();
+
+    m_url = suggestion_url;
+    m_text = trimmed;
+    m_context = context;
+    m_callback = callback;
+    m_timer->start();
+}
+
+void SuggestionFetcher::cancel()
+{
+    m_timer->stop();
+    abort();
+    m_callback = nullptr;
+}
+
+QStringList SuggestionFetcher::parse(const QByteArray &data)
+{
+    QStringList suggestions;
+    const QByteArray trimmed = data.trimmed();
+
+    // Google: <toplevel><CompleteSuggestion><suggestion data="..."/></CompleteSuggestion></toplevel>
+    if (trimmed.startsWith('<')) {
+        QXmlStreamReader reader(trimmed);
+        while (!reader.atEnd()) {
+            reader.readNext();
+            if (reader.isStartElement() && reader.name() == QLatin1String("suggestion")) {
+                const QString suggestion = reader.attributes().value(QLatin1String("data")).toString();
+                if (!suggestion.isEmpty())
+                    suggestions << suggestion;
+            }
+        }
+        return suggestions;
+    }
+
+    const QJsonDocument document = QJsonDocument::fromJson(trimmed);
+    QJsonArray values;
+    if (document.isArray()) {
+        const QJsonArray array = document.array();
+        // OpenSearch: ["query", ["suggestion", ...]], otherwise a plain list like [{"phrase": "..."}]
+        if (array.count() >= 2 && array.at(0).isString() && array.at(1).isArray())
+            values = array.at(1).toArray();
+        else
+            values = array;
+    } else if (document.isObject()) {
+        // Ecosia: {"query": "...", "suggestions": ["suggestion", ...]}
+        values = document.object().value(QLatin1String("suggestions")).toArray();
+    }
+
+    for (const QJsonValue &value : qAsConst(values)) {
+        const QString suggestion = suggestion_text(value);
+        if (!suggestion.isEmpty())
+            suggestions << suggestion;
+    }
+
+    return suggestions;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QTimer>
+
+#include <functional>
+
+class SuggestionFetcher : public QObject
+{
+    struct CachedSuggestions
+    {
+        QStringList suggestions;
+        QDateTime expires;
+    };
+
+    QNetworkAccessManager *m_manager = nullptr;
+    QTimer *m_timer = nullptr;
+    QNetworkReply *m_reply = nullptr;
+    QHash<QString, CachedSuggestions> m_cache;
+
+    QString m_url;
+    QString m_text;
+    QPointer<QObject> m_context;
+    std::function<void (const QStringList &)> m_callback;
+
+    void start();
+    void abort();
+    void cache(const QString &key, const QStringList &suggestions);
+public:
+    explicit SuggestionFetcher(QObject *parent = nullptr);
+    ~SuggestionFetcher();
+
+    void fetch(const QString &suggestion_url, const QString &text, QObject *context, const std::function<void (const QStringList &)> &callback);
+    void cancel();
+
+    static QStringList parse(const QByteArray &data);
+};
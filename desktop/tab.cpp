@@ -1,22 +1,36 @@
 #include "bookmarks.h"
 #include "browser.h"
 #include "history.h"
+#include "history_retention.h"
+#include "memory_pressure.h"
+#include "omnibox.h"
+#include "preloader.h"
 #include "search_engine.h"
+#include "session.h"
 #include "tab.h"
+#include "task_manager.h"
 #include "webview.h"
 
 #include <QCheckBox>
 #include <QComboBox>
+#include <QDataStream>
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QIcon>
 #include <QLabel>
+#include <QPushButton>
 #include <QScrollArea>
+#include <QSpinBox>
 #include <QVBoxLayout>
 #include <QWebEngineHistory>
 #include <QWebEngineProfile>
 #include <QWebEngineSettings>
 
+const int RELOAD_DELAY = 1000;
+const int MAX_RELOAD_DELAY = 60 * 1000;
+const int MAX_AUTOMATIC_RELOADS = 5;
+const qint64 CRASH_RESET_INTERVAL = 5 * 60 * 1000;
+
 Tab::Tab(QWidget *parent)
     : QWidget(parent)
 {
@@ -37,7 +51,7 @@ void WebTab::setup_toolbar()
     m_home_button = create_tool_button(QStringLiteral("go-home"));
     m_download_button = create_tool_button(QStringLiteral("edit-download"));
 
-    m_address_bar = new QLineEdit;
+    m_address_bar = new Omnibox;
     m_bookmark_action = m_address_bar->addAction(QIcon::fromTheme(QStringLiteral("bookmark-new")), QLineEdit::TrailingPosition);
 
     m_toolbar->addWidget(m_back_button);
@@ -60,6 +74,15 @@ void WebTab::setup_toolbar()
     connect(m_home_button, &QToolButton::clicked, m_webview, &WebView::home);
     connect(m_address_bar, &QLineEdit::returnPressed, [this] {
         const QString text = m_address_bar->text();
+
+        // keywords and bangs go straight to their engine instead of through a redirect service
+        const QString destination = browser->search_model()->resolve_keyword(text);
+        if (!destination.isEmpty()) {
+            m_webview->load(QUrl(destination));
+            m_webview->setFocus();
+            return ;
+        }
+
         const QUrl url = QUrl::fromUserInput(text);
         if (url.isValid()) {
             if (url.scheme() == QStringLiteral("javascript")) {
@@ -67,6 +90,19 @@ void WebTab::setup_toolbar()
                 m_webview->page()->runJavaScript(code);
                 return ;
             } else if (url.host() == QStringLiteral("localhost") || url.host().split(QStringLiteral(".")).count() > 1) {
+                // swapping pages drops back/forward history, so only fresh tabs take the preloaded page
+                WebPage *page = browser->preloader()->take(url);
+                if (page && m_webview->history()->count() <= 1) {
+                    m_webview->adopt_page(page);
+                    m_address_bar->setText(page->url().toEncoded());
+                    m_address_bar->setCursorPosition(0);
+                    m_back_button->setEnabled(false);
+                    m_forward_button->setEnabled(false);
+                    m_webview->setFocus();
+                    return ;
+                }
+
+                delete page;
                 m_webview->load(url);
                 return ;
             }
@@ -77,7 +113,7 @@ void WebTab::setup_toolbar()
         m_webview->setFocus();
     });
 
-    connect(m_bookmark_action, &QAction::triggered, this, &WebTab::bookmark);
+    connect(m_bookmark_action, &QAction::triggered, this, &WebTab::toggle_bookmark);
 
     connect(m_download_button, &QToolButton::clicked, [this] {
         QWidget *widget = (QWidget *)browser->download_widget();
@@ -90,7 +126,13 @@ void WebTab::setup_toolbar()
     connect(m_webview, &WebView::urlChanged, [this] (const QUrl &address) {
         m_address_bar->setText(address.toEncoded());
         m_address_bar->setCursorPosition(0);
+        update_bookmark_action();
     });
+
+    BookmarkModel *bookmark_model = browser->bookmark_model();
+    connect(bookmark_model, &BookmarkModel::rowsInserted, this, &WebTab::update_bookmark_action);
+    connect(bookmark_model, &BookmarkModel::rowsRemoved, this, &WebTab::update_bookmark_action);
+    connect(bookmark_model, &BookmarkModel::dataChanged, this, &WebTab::update_bookmark_action);
     connect(m_webview, &WebView::loadStarted, [this] {
         m_refresh_button->setIcon(QIcon::fromTheme(QStringLiteral("process-stop")));
     });
@@ -101,46 +143,316 @@ void WebTab::setup_toolbar()
     });
 }
 
-WebTab::WebTab(QWidget *parent)
-    : Tab(parent)
+void WebTab::create_webview()
 {
     m_toolbar = new QToolBar;
     m_webview = new WebView;
 
+    layout()->addWidget(m_toolbar);
+    layout()->addWidget(m_webview);
+
+    setup_toolbar();
+
+    connect(m_webview, &WebView::titleChanged, [this] (const QString &title) { emit title_changed(title); });
+    connect(m_webview, &WebView::iconChanged, [this] (const QIcon &icon) { emit icon_changed(icon); });
+    connect(m_webview, &WebView::renderProcessTerminated, this, &WebTab::render_process_terminated);
+
+    if (SessionManager *session_manager = browser->session_manager()) {
+        connect(m_webview, &WebView::urlChanged, session_manager, [this, session_manager] { session_manager->tab_changed(this); });
+        connect(m_webview, &WebView::titleChanged, session_manager, [this, session_manager] { session_manager->tab_changed(this); });
+        connect(m_webview, &WebView::loadFinished, session_manager, [this, session_manager] { session_manager->tab_changed(this); });
+    }
+
+    if (m_pending_page) {
+        disconnect(m_pending_page, nullptr, this, nullptr);
+        m_webview->adopt_page(m_pending_page, m_is_pending_page_loaded);
+        m_address_bar->setText(m_webview->url().toEncoded());
+        m_address_bar->setCursorPosition(0);
+    } else if (!m_pending_history.isEmpty()) {
+        QDataStream stream(m_pending_history);
+        stream >> *m_webview->history();
+    } else if (!m_pending_url.isEmpty()) {
+        m_address_bar->setText(m_pending_url.toEncoded());
+        m_address_bar->setCursorPosition(0);
+        m_webview->load(m_pending_url);
+    }
+
+    m_pending_url.clear();
+    m_pending_title.clear();
+    m_pending_icon = QIcon();
+    m_pending_history.clear();
+    m_pending_page.clear();
+}
+
+void WebTab::setup_crash_page()
+{
+    m_crash_page = new QWidget;
+    m_crash_label = new QLabel;
+    m_crash_label->setAlignment(Qt::AlignCenter);
+    m_crash_label->setWordWrap(true);
+
+    QPushButton *reload = new QPushButton(QStringLiteral("Reload"));
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    m_crash_page->setLayout(vbox);
+    vbox->addStretch();
+    vbox->addWidget(m_crash_label);
+    vbox->addWidget(reload, 0, Qt::AlignCenter);
+    vbox->addStretch();
+
+    layout()->addWidget(m_crash_page);
+
+    m_reload_timer = new QTimer(this);
+    m_reload_timer->setSingleShot(true);
+
+    connect(reload, &QPushButton::clicked, this, &WebTab::recover);
+
+    // navigating from the address bar or history brings the view back by itself
+    connect(m_webview, &WebView::loadStarted, this, &WebTab::close_crash_page);
+    connect(m_webview, &WebView::urlChanged, this, &WebTab::close_crash_page);
+    connect(m_reload_timer, &QTimer::timeout, [this] {
+        // reloading while memory is this tight would only bring the renderer down again
+        if (browser->memory_pressure()->level() == MemoryPressureMonitor::Critical) {
+            m_reload_timer->start(MAX_RELOAD_DELAY);
+            return;
+        }
+
+        recover();
+    });
+}
+
+void WebTab::render_process_terminated(QWebEnginePage::RenderProcessTerminationStatus status)
+{
+    if (status == QWebEnginePage::NormalTerminationStatus)
+        return;
+
+    if (!m_crash_page)
+        setup_crash_page();
+
+    // only crashes in quick succession back off, one long after the last starts over
+    if (m_last_crash.isValid() && m_last_crash.elapsed() > CRASH_RESET_INTERVAL)
+        m_crash_count = 0;
+    m_last_crash.start();
+    m_crash_count++;
+    m_is_crashed = true;
+    m_reload_delay = qMin(RELOAD_DELAY << qMin(m_crash_count - 1, 16), MAX_RELOAD_DELAY);
+
+    QString text = status == QWebEnginePage::KilledTerminationStatus
+            ? QStringLiteral("This page was stopped, possibly because the system ran out of memory.")
+            : QStringLiteral("This page crashed.");
+    if (m_crash_count > MAX_AUTOMATIC_RELOADS)
+        text += QStringLiteral("\nIt keeps stopping, so it will not be reloaded automatically.");
+    m_crash_label->setText(text);
+
+    m_webview->hide();
+    m_crash_page->show();
+
+    // background tabs wait until they are selected, so a shared renderer going down reloads one page at a time
+    if (isVisible() && m_crash_count <= MAX_AUTOMATIC_RELOADS)
+        m_reload_timer->start(m_reload_delay);
+}
+
+void WebTab::close_crash_page()
+{
+    if (!m_is_crashed)
+        return;
+
+    m_reload_timer->stop();
+    m_is_crashed = false;
+
+    m_crash_page->hide();
+    m_webview->show();
+}
+
+void WebTab::recover()
+{
+    close_crash_page();
+    m_webview->reload();
+}
+
+void WebTab::showEvent(QShowEvent *event)
+{
+    if (!m_webview)
+        create_webview();
+
+    if (m_is_crashed && m_crash_count <= MAX_AUTOMATIC_RELOADS && !m_reload_timer->isActive())
+        m_reload_timer->start(int(qMax<qint64>(0, m_reload_delay - m_last_crash.elapsed())));
+
+    Tab::showEvent(event);
+}
+
+void WebTab::hideEvent(QHideEvent *event)
+{
+    if (m_reload_timer)
+        m_reload_timer->stop();
+
+    Tab::hideEvent(event);
+}
+
+WebTab::WebTab(QWidget *parent)
+    : Tab(parent)
+{
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->setContentsMargins(0, 0, 0, 0);
     vbox->setSpacing(0);
     setLayout(vbox);
 
-    vbox->addWidget(m_toolbar);
-    vbox->addWidget(m_webview);
-
-    setup_toolbar();
+    create_webview();
+}
 
-    connect(m_webview, &WebView::titleChanged, [this] (const QString &title) { emit title_changed(title); });
-    connect(m_webview, &WebView::iconChanged, [this] (const QIcon &icon) { emit icon_changed(icon); });
+WebTab::WebTab(const QUrl &url, const QString &title, const QIcon &icon, QWidget *parent)
+    : Tab(parent)
+    , m_pending_url(url)
+    , m_pending_title(title)
+    , m_pending_icon(icon)
+{
+    // only the address is kept until the tab is first shown, the view and its renderer come later
+    QVBoxLayout *vbox = new QVBoxLayout;
+    vbox->setContentsMargins(0, 0, 0, 0);
+    vbox->setSpacing(0);
+    setLayout(vbox);
 }
 
-QToolBar *WebTab::toolbar() const
+QToolBar *WebTab::toolbar()
 {
+    if (!m_webview)
+        create_webview();
     return m_toolbar;
 }
 
-QLineEdit *WebTab::address_bar() const
+QLineEdit *WebTab::address_bar()
 {
+    if (!m_webview)
+        create_webview();
     return m_address_bar;
 }
 
-WebView *WebTab::webview() const
+WebView *WebTab::webview()
 {
+    if (!m_webview)
+        create_webview();
     return m_webview;
 }
 
+bool WebTab::has_webview() const
+{
+    return m_webview;
+}
+
+QUrl WebTab::url() const
+{
+    return m_webview ? m_webview->url() : m_pending_url;
+}
+
+QString WebTab::title() const
+{
+    if (m_webview)
+        return m_webview->title();
+    return m_pending_title.isEmpty() ? m_pending_url.toString() : m_pending_title;
+}
+
+QIcon WebTab::icon() const
+{
+    return m_webview ? m_webview->icon() : m_pending_icon;
+}
+
+QByteArray WebTab::history_state() const
+{
+    if (!m_webview)
+        return m_pending_history;
+
+    QByteArray state;
+    QDataStream stream(&state, QIODevice::WriteOnly);
+    stream << *m_webview->history();
+    return state;
+}
+
+void WebTab::set_history_state(const QByteArray &state)
+{
+    if (m_webview) {
+        QDataStream stream(state);
+        stream >> *m_webview->history();
+        return;
+    }
+
+    m_pending_history = state;
+}
+
+void WebTab::set_pending_page(WebPage *page)
+{
+    if (m_webview) {
+        m_webview->adopt_page(page, false);
+        return;
+    }
+
+    // the page loads without a view, the placeholder only mirrors what the tab bar and session need
+    page->setParent(this);
+    m_pending_page = page;
+    m_is_pending_page_loaded = false;
+
+    connect(page, &WebPage::loadStarted, this, [this] { m_is_pending_page_loaded = false; });
+    connect(page, &WebPage::loadFinished, this, [this] { m_is_pending_page_loaded = true; });
+    connect(page, &WebPage::urlChanged, this, [this] (const QUrl &url) {
+        m_pending_url = url;
+        if (SessionManager *session_manager = browser->session_manager())
+            session_manager->tab_changed(this);
+    });
+    connect(page, &WebPage::titleChanged, this, [this] (const QString &title) {
+        m_pending_title = title;
+        emit title_changed(title);
+    });
+    connect(page, &WebPage::iconChanged, this, [this] (const QIcon &icon) {
+        m_pending_icon = icon;
+        emit icon_changed(icon);
+    });
+}
+
+bool WebTab::is_pinned() const
+{
+    return m_is_pinned;
+}
+
+void WebTab::set_pinned(bool is_pinned)
+{
+    m_is_pinned = is_pinned;
+
+    if (SessionManager *session_manager = browser->session_manager())
+        session_manager->tab_changed(this);
+}
+
+void WebTab::update_bookmark_action()
+{
+    if (browser->bookmark_model()->is_bookmarked(url().toString())) {
+        m_bookmark_action->setIcon(QIcon::fromTheme(QStringLiteral("rating")));
+        m_bookmark_action->setToolTip(QStringLiteral("Remove bookmark"));
+    } else {
+        m_bookmark_action->setIcon(QIcon::fromTheme(QStringLiteral("bookmark-new")));
+        m_bookmark_action->setToolTip(QStringLiteral("Bookmark this page"));
+    }
+}
+
+void WebTab::toggle_bookmark()
+{
+    BookmarkModel *bookmark_model = browser->bookmark_model();
+    const QList<BookmarkTreeNode *> nodes = bookmark_model->find_bookmarks(url().toString());
+    if (nodes.isEmpty()) {
+        bookmark();
+        return;
+    }
+
+    for (BookmarkTreeNode *node : nodes) {
+        bookmark_model->remove_bookmark(node);
+    }
+}
+
 void WebTab::bookmark()
 {
+    if (browser->bookmark_model()->is_bookmarked(url().toString()))
+        return;
+
     BookmarkTreeNode *node = new BookmarkTreeNode(BookmarkTreeNode::Address);
-    node->title = m_webview->title();
-    node->address = m_webview->url().toString();
+    node->title = title();
+    node->address = url().toString();
     browser->bookmark_model()->add_bookmark(nullptr, node);
 }
 
@@ -152,11 +464,13 @@ void ManagerTab::setup_toolbar()
     QAction *history = m_toolbar->addAction(QIcon::fromTheme(QStringLiteral("appointment-new")), QStringLiteral("History"));
     QAction *bookmarks = m_toolbar->addAction(QIcon::fromTheme(QStringLiteral("bookmark-new")), QStringLiteral("Bookmarks"));
     QAction *search = m_toolbar->addAction(QIcon::fromTheme(QStringLiteral("edit-find")), QStringLiteral("Search"));
+    QAction *tasks = m_toolbar->addAction(QIcon::fromTheme(QStringLiteral("utilities-system-monitor")), QStringLiteral("Tasks"));
 
     connect(settings, &QAction::triggered, this, &ManagerTab::open_settings);
     connect(history, &QAction::triggered, this, &ManagerTab::open_history);
     connect(bookmarks, &QAction::triggered, this, &ManagerTab::open_bookmarks);
     connect(search, &QAction::triggered, this, &ManagerTab::open_search);
+    connect(tasks, &QAction::triggered, this, &ManagerTab::open_tasks);
 }
 
 void ManagerTab::setup_stacked_widget()
@@ -169,6 +483,9 @@ void ManagerTab::setup_stacked_widget()
 
     SearchWidget *search_widget = new SearchWidget;
     m_stacked_widget->addWidget(search_widget);
+
+    TaskManagerWidget *task_manager_widget = new TaskManagerWidget;
+    m_stacked_widget->addWidget(task_manager_widget);
 }
 
 void ManagerTab::setup_settings_widget()
@@ -196,6 +513,99 @@ void ManagerTab::setup_settings_widget()
 
         grid->addWidget(new QLabel(QStringLiteral("Homepage")), 0, 0);
         grid->addWidget(homepage, 0, 1);
+
+        QSpinBox *freeze_after = new QSpinBox;
+        freeze_after->setRange(0, 1440);
+        freeze_after->setSpecialValueText(QStringLiteral("Never"));
+        freeze_after->setSuffix(QStringLiteral(" min"));
+        freeze_after->setValue(m_settings.value(QStringLiteral("tabs/freeze_after_minutes"), 5).toInt());
+        connect(freeze_after, QOverload<int>::of(&QSpinBox::valueChanged), [this] (int value) {
+            m_settings.setValue(QStringLiteral("tabs/freeze_after_minutes"), value);
+        });
+
+        QSpinBox *discard_after = new QSpinBox;
+        discard_after->setRange(0, 1440);
+        discard_after->setSpecialValueText(QStringLiteral("Never"));
+        discard_after->setSuffix(QStringLiteral(" min"));
+        discard_after->setValue(m_settings.value(QStringLiteral("tabs/discard_after_minutes"), 30).toInt());
+        connect(discard_after, QOverload<int>::of(&QSpinBox::valueChanged), [this] (int value) {
+            m_settings.setValue(QStringLiteral("tabs/discard_after_minutes"), value);
+        });
+
+        grid->addWidget(new QLabel(QStringLiteral("Pause background tabs after")), 1, 0);
+        grid->addWidget(freeze_after, 1, 1);
+        grid->addWidget(new QLabel(QStringLiteral("Unload background tabs after")), 2, 0);
+        grid->addWidget(discard_after, 2, 1);
+
+        QCheckBox *preload_pages = new QCheckBox(QStringLiteral("Preload likely pages while typing in the address bar"));
+        preload_pages->setChecked(m_settings.value(QStringLiteral("browsing/preload_pages"), true).toBool());
+        connect(preload_pages, &QCheckBox::clicked, [this] (bool checked) {
+            m_settings.setValue(QStringLiteral("browsing/preload_pages"), checked);
+        });
+        vbox->addWidget(preload_pages);
+
+        QCheckBox *search_suggestions = new QCheckBox(QStringLiteral("Search suggestions"));
+        search_suggestions->setToolTip(QStringLiteral("Send what you type in the address bar to the default search engine for suggestions"));
+        search_suggestions->setChecked(m_settings.value(QStringLiteral("browsing/search_suggestions"), true).toBool());
+        connect(search_suggestions, &QCheckBox::clicked, [this] (bool checked) {
+            m_settings.setValue(QStringLiteral("browsing/search_suggestions"), checked);
+        });
+        vbox->addWidget(search_suggestions);
+
+        QCheckBox *persist_thumbnails = new QCheckBox(QStringLiteral("Keep tab previews on disk between sessions"));
+        persist_thumbnails->setChecked(m_settings.value(QStringLiteral("tabs/persist_thumbnails"), false).toBool());
+        connect(persist_thumbnails, &QCheckBox::clicked, [this] (bool checked) {
+            m_settings.setValue(QStringLiteral("tabs/persist_thumbnails"), checked);
+        });
+        vbox->addWidget(persist_thumbnails);
+    }
+
+    QGroupBox *history_group = new QGroupBox;
+    history_group->setTitle(QStringLiteral("History"));
+    vbox->addWidget(history_group);
+    {
+        QVBoxLayout *vbox = new QVBoxLayout;
+        history_group->setLayout(vbox);
+
+        QGridLayout *grid = new QGridLayout;
+        vbox->addLayout(grid);
+
+        const RetentionPolicy policy = RetentionPolicy::from_settings();
+
+        QSpinBox *max_age_days = new QSpinBox;
+        max_age_days->setRange(0, 3650);
+        max_age_days->setSpecialValueText(QStringLiteral("Forever"));
+        max_age_days->setSuffix(QStringLiteral(" days"));
+        max_age_days->setValue(policy.max_age_days);
+        connect(max_age_days, QOverload<int>::of(&QSpinBox::valueChanged), [this] (int value) {
+            m_settings.setValue(QStringLiteral("history/max_age_days"), value);
+        });
+
+        QSpinBox *max_entries = new QSpinBox;
+        max_entries->setRange(0, 10000000);
+        max_entries->setSingleStep(1000);
+        max_entries->setSpecialValueText(QStringLiteral("Unlimited"));
+        max_entries->setValue(policy.max_entries);
+        connect(max_entries, QOverload<int>::of(&QSpinBox::valueChanged), [this] (int value) {
+            m_settings.setValue(QStringLiteral("history/max_entries"), value);
+        });
+
+        QSpinBox *max_size_mb = new QSpinBox;
+        max_size_mb->setRange(0, 100000);
+        max_size_mb->setSingleStep(16);
+        max_size_mb->setSpecialValueText(QStringLiteral("Unlimited"));
+        max_size_mb->setSuffix(QStringLiteral(" MB"));
+        max_size_mb->setValue(policy.max_size_mb);
+        connect(max_size_mb, QOverload<int>::of(&QSpinBox::valueChanged), [this] (int value) {
+            m_settings.setValue(QStringLiteral("history/max_size_mb"), value);
+        });
+
+        grid->addWidget(new QLabel(QStringLiteral("Keep history for")), 0, 0);
+        grid->addWidget(max_age_days, 0, 1);
+        grid->addWidget(new QLabel(QStringLiteral("Maximum entries")), 1, 0);
+        grid->addWidget(max_entries, 1, 1);
+        grid->addWidget(new QLabel(QStringLiteral("Maximum database size")), 2, 0);
+        grid->addWidget(max_size_mb, 2, 1);
     }
 
     QGroupBox *download_group = new QGroupBox;
@@ -369,3 +779,10 @@ void ManagerTab::open_search()
     emit title_changed(QStringLiteral("Search"));
     emit icon_changed(QIcon::fromTheme(QStringLiteral("edit-find")));
 }
+
+void ManagerTab::open_tasks()
+{
+    m_stacked_widget->setCurrentIndex(4);
+    emit title_changed(QStringLiteral("Tasks"));
+    emit icon_changed(QIcon::fromTheme(QStringLiteral("utilities-system-monitor")));
+}
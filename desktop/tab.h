@@ -1,12 +1,20 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QIcon>
+#include <QLabel>
 #include <QLineEdit>
+#include <QPointer>
 #include <QSettings>
 #include <QStackedWidget>
+#include <QTimer>
 #include <QToolBar>
 #include <QToolButton>
+#include <QUrl>
+#include <QWebEnginePage>
 #include <QWidget>
 
+class WebPage;
 class WebView;
 
 class Tab : public QWidget
@@ -34,15 +42,53 @@ public:
 
     QLineEdit *m_address_bar = nullptr;
     QAction *m_bookmark_action = nullptr;
+    bool m_is_pinned = false;
 
+    QUrl m_pending_url;
+    QString m_pending_title;
+    QIcon m_pending_icon;
+    QByteArray m_pending_history;
+    QPointer<WebPage> m_pending_page;
+    bool m_is_pending_page_loaded = false;
+
+    QWidget *m_crash_page = nullptr;
+    QLabel *m_crash_label = nullptr;
+    QTimer *m_reload_timer = nullptr;
+    QElapsedTimer m_last_crash;
+    int m_crash_count = 0;
+    int m_reload_delay = 0;
+    bool m_is_crashed = false;
+
+    void create_webview();
+    void setup_crash_page();
+    void render_process_terminated(QWebEnginePage::RenderProcessTerminationStatus status);
+    void close_crash_page();
+    void recover();
     void setup_toolbar();
+    void update_bookmark_action();
+    void toggle_bookmark();
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 public:
     explicit WebTab(QWidget *parent = nullptr);
-    QToolBar *toolbar() const;
-    QLineEdit *address_bar() const;
-    WebView *webview() const;
+    explicit WebTab(const QUrl &url, const QString &title, const QIcon &icon = QIcon(), QWidget *parent = nullptr);
+    QToolBar *toolbar();
+    QLineEdit *address_bar();
+    WebView *webview();
+
+    bool has_webview() const;
+    QUrl url() const;
+    QString title() const;
+    QIcon icon() const;
+    QByteArray history_state() const;
+    void set_history_state(const QByteArray &state);
+    void set_pending_page(WebPage *page);
 
     void bookmark();
+
+    bool is_pinned() const;
+    void set_pinned(bool is_pinned);
 };
 
 class ManagerTab : public Tab
@@ -62,4 +108,5 @@ public:
     void open_history();
     void open_bookmarks();
     void open_search();
+    void open_tasks();
 };
@@ -0,0 +1,135 @@
+#include "tab.h"
+#include "tab_lifecycle.h"
+#include "webview.h"
+
+#include <QSettings>
+
+const int CHECK_INTERVAL = 30 * 1000;
+const qint64 MSECS_PER_MINUTE = 60 * 1000;
+
+void TabLifecycle::check()
+{
+    QSettings settings;
+    const qint64 freeze_after = settings.value(QStringLiteral("tabs/freeze_after_minutes"), 5).toLongLong() * MSECS_PER_MINUTE;
+    const qint64 discard_after = settings.value(QStringLiteral("tabs/discard_after_minutes"), 30).toLongLong() * MSECS_PER_MINUTE;
+    const qint64 now = m_clock.elapsed();
+
+    for (int i = 0; i < m_stacked_widget->count(); i++) {
+        WebTab *tab = dynamic_cast<WebTab *>(m_stacked_widget->widget(i));
+        if (!can_suspend(tab))
+            continue;
+
+        const qint64 hidden_for = now - m_hidden_since.value(tab, now);
+        if (discard_after > 0 && hidden_for >= discard_after)
+            suspend_tab(tab, QWebEnginePage::LifecycleState::Discarded);
+        else if (freeze_after > 0 && hidden_for >= freeze_after)
+            suspend_tab(tab, QWebEnginePage::LifecycleState::Frozen);
+    }
+}
+
+bool TabLifecycle::can_suspend(WebTab *tab) const
+{
+    if (!tab || tab == m_current_tab || tab->is_pinned() || !tab->has_webview())
+        return false;
+
+    return !tab->webview()->page()->recentlyAudible();
+}
+
+bool TabLifecycle::suspend_tab(WebTab *tab, QWebEnginePage::LifecycleState state)
+{
+    if (!tab->has_webview())
+        return false;
+
+    QWebEnginePage *page = tab->webview()->page();
+
+    // the recommended state keeps pages with form input or background work from going too far
+    if (state > page->recommendedState())
+        state = page->recommendedState();
+
+    if (state <= page->lifecycleState())
+        return false;
+
+    page->setLifecycleState(state);
+    update_hint(tab);
+    return true;
+}
+
+void TabLifecycle::activate(int index)
+{
+    if (m_current_tab)
+        m_hidden_since.insert(m_current_tab, m_clock.elapsed());
+
+    Tab *tab = dynamic_cast<Tab *>(m_stacked_widget->widget(index));
+    m_current_tab = tab;
+    if (!tab)
+        return;
+
+    m_hidden_since.remove(tab);
+    WebTab *web_tab = dynamic_cast<WebTab *>(tab);
+    if (web_tab && web_tab->has_webview()) {
+        web_tab->webview()->page()->setLifecycleState(QWebEnginePage::LifecycleState::Active);
+        update_hint(web_tab);
+    }
+}
+
+void TabLifecycle::update_hint(WebTab *tab)
+{
+    const int index = m_stacked_widget->indexOf(tab);
+    if (index == -1)
+        return;
+
+    switch (tab->webview()->page()->lifecycleState()) {
+    case QWebEnginePage::LifecycleState::Active:
+        m_tabbar->setTabTextColor(index, QColor());
+        m_tabbar->setTabToolTip(index, QString());
+        break;
+    case QWebEnginePage::LifecycleState::Frozen:
+        m_tabbar->setTabTextColor(index, m_tabbar->palette().color(QPalette::Disabled, QPalette::WindowText));
+        m_tabbar->setTabToolTip(index, QStringLiteral("Paused to save power"));
+        break;
+    case QWebEnginePage::LifecycleState::Discarded:
+        m_tabbar->setTabTextColor(index, m_tabbar->palette().color(QPalette::Disabled, QPalette::WindowText));
+        m_tabbar->setTabToolTip(index, QStringLiteral("Unloaded to save memory, reloads when selected"));
+        break;
+    }
+}
+
+TabLifecycle::TabLifecycle(QTabBar *tabbar, QStackedWidget *stacked_widget, QObject *parent)
+    : QObject(parent)
+    , m_tabbar(tabbar)
+    , m_stacked_widget(stacked_widget)
+{
+    m_clock.start();
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(CHECK_INTERVAL);
+    m_timer->start();
+
+    connect(m_timer, &QTimer::timeout, this, &TabLifecycle::check);
+    connect(m_stacked_widget, &QStackedWidget::currentChanged, this, &TabLifecycle::activate);
+}
+
+QSet<qint64> TabLifecycle::suspend(QWebEnginePage::LifecycleState state)
+{
+    QSet<qint64> pids;
+    for (int i = 0; i < m_stacked_widget->count(); i++) {
+        WebTab *tab = dynamic_cast<WebTab *>(m_stacked_widget->widget(i));
+        if (!can_suspend(tab))
+            continue;
+
+        const qint64 pid = tab->webview()->page()->renderProcessPid();
+        if (suspend_tab(tab, state) && pid > 0)
+            pids.insert(pid);
+    }
+    return pids;
+}
+
+void TabLifecycle::add_tab(Tab *tab)
+{
+    if (tab != m_current_tab)
+        m_hidden_since.insert(tab, m_clock.elapsed());
+
+    connect(tab, &QObject::destroyed, this, [this, tab] {
+        m_hidden_since.remove(tab);
+    });
+}
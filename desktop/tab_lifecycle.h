@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QStackedWidget>
+#include <QTabBar>
+#include <QTimer>
+#include <QWebEnginePage>
+
+class Tab;
+class WebTab;
+
+class TabLifecycle : public QObject
+{
+    QTabBar *m_tabbar = nullptr;
+    QStackedWidget *m_stacked_widget = nullptr;
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_clock;
+    QHash<Tab *, qint64> m_hidden_since;
+    QPointer<Tab> m_current_tab;
+
+    void check();
+    void activate(int index);
+    bool can_suspend(WebTab *tab) const;
+    void update_hint(WebTab *tab);
+public:
+    explicit TabLifecycle(QTabBar *tabbar, QStackedWidget *stacked_widget, QObject *parent = nullptr);
+
+    QSet<qint64> suspend(QWebEnginePage::LifecycleState state);
+    bool suspend_tab(WebTab *tab, QWebEnginePage::LifecycleState state);
+    void add_tab(Tab *tab);
+};
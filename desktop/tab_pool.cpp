@@ -0,0 +1,98 @@
+#include "tab.h"
+#include "tab_pool.h"
+#include "webview.h"
+
+#include <QCoreApplication>
+#include <QSettings>
+
+const int POOL_SIZE = 1;
+const int REFILL_DELAY = 1000;
+const int MAX_SPARE_AGE = 30 * 60 * 1000;
+
+static QString homepage()
+{
+    return QSettings().value(QStringLiteral("browsing/homepage"), QStringLiteral("browser:startpage")).toString();
+}
+
+void TabPool::load(Spare *spare)
+{
+    spare->homepage = homepage();
+    spare->age.start();
+    spare->tab->webview()->home();
+}
+
+void TabPool::refill()
+{
+    if (m_spares.count() >= POOL_SIZE)
+        return;
+
+    // spares are built one at a time so a refill never stalls the window for long
+    Spare *spare = new Spare;
+    spare->tab = new WebTab;
+    load(spare);
+    m_spares.append(spare);
+
+    if (m_spares.count() < POOL_SIZE)
+        m_refill_timer->start();
+}
+
+void TabPool::refresh()
+{
+    // keeps a spare from showing a page that went stale while it sat unused
+    for (Spare *spare : qAsConst(m_spares)) {
+        if (spare->age.hasExpired(MAX_SPARE_AGE))
+            load(spare);
+    }
+}
+
+TabPool::TabPool(QObject *parent)
+    : QObject(parent)
+{
+    m_refill_timer = new QTimer(this);
+    m_refill_timer->setSingleShot(true);
+    m_refill_timer->setInterval(REFILL_DELAY);
+    m_refill_timer->start();
+
+    connect(m_refill_timer, &QTimer::timeout, this, &TabPool::refill);
+
+    m_refresh_timer = new QTimer(this);
+    m_refresh_timer->setInterval(MAX_SPARE_AGE);
+    m_refresh_timer->start();
+
+    connect(m_refresh_timer, &QTimer::timeout, this, &TabPool::refresh);
+
+    // spare views have no parent, so they have to go before the application does
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &TabPool::release);
+}
+
+TabPool::~TabPool()
+{
+    release();
+}
+
+WebTab *TabPool::take()
+{
+    m_refill_timer->start();
+    if (m_spares.isEmpty())
+        return nullptr;
+
+    Spare *spare = m_spares.takeFirst();
+    WebTab *tab = spare->tab;
+
+    // the renderer is still warm, only the page has to be loaded again
+    if (spare->homepage != homepage() || spare->age.hasExpired(MAX_SPARE_AGE))
+        load(spare);
+
+    delete spare;
+    return tab;
+}
+
+void TabPool::release()
+{
+    m_refill_timer->stop();
+    for (Spare *spare : qAsConst(m_spares)) {
+        delete spare->tab;
+    }
+    qDeleteAll(m_spares);
+    m_spares.clear();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+class WebTab;
+
+class TabPool : public QObject
+{
+    struct Spare
+    {
+        WebTab *tab = nullptr;
+        QString homepage;
+        QElapsedTimer age;
+    };
+
+    QList<Spare *> m_spares;
+    QTimer *m_refill_timer = nullptr;
+    QTimer *m_refresh_timer = nullptr;
+
+    void refill();
+    void refresh();
+    void load(Spare *spare);
+public:
+    explicit TabPool(QObject *parent = nullptr);
+    ~TabPool();
+
+    WebTab *take();
+    void release();
+};
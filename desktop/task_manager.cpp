@@ -0,0 +1,441 @@
+#include "browser_window.h"
+#include "tab.h"
+#include "task_manager.h"
+#include "webview.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLocale>
+#include <QThread>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+const int SAMPLE_INTERVAL = 1000;
+
+static qint64 page_size()
+{
+#ifdef Q_OS_UNIX
+    static const qint64 size = sysconf(_SC_PAGESIZE);
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+static double clock_ticks()
+{
+#ifdef Q_OS_UNIX
+    static const double ticks = sysconf(_SC_CLK_TCK);
+    return ticks;
+#else
+    return 100;
+#endif
+}
+
+qint64 ProcessSampler::resident_bytes(qint64 pid)
+{
+    QFile file(QStringLiteral("/proc/%1/statm").arg(pid));
+    if (!file.open(QFile::ReadOnly))
+        return -1;
+
+    const QList<QByteArray> fields = file.readLine().split(' ');
+    if (fields.count() < 2)
+        return -1;
+
+    return fields.at(1).toLongLong() * page_size();
+}
+
+static bool read_cpu_ticks(qint64 pid, quint64 *ticks)
+{
+    QFile file(QStringLiteral("/proc/%1/stat").arg(pid));
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    // the command name may contain spaces, so fields are counted from its closing parenthesis
+    const QByteArray line = file.readLine();
+    const int end = line.lastIndexOf(')');
+    if (end == -1)
+        return false;
+
+    const QList<QByteArray> fields = line.mid(end + 2).split(' ');
+    if (fields.count() < 13)
+        return false;
+
+    *ticks = fields.at(11).toULongLong() + fields.at(12).toULongLong();
+    return true;
+}
+
+ProcessSampler::ProcessSampler()
+{
+    m_clock.start();
+}
+
+QVector<ProcessSample> ProcessSampler::sample(const QVector<qint64> &pids)
+{
+    QVector<ProcessSample> samples;
+    QHash<qint64, Ticks> current;
+    const qint64 now = m_clock.elapsed();
+
+    for (qint64 pid : pids) {
+        ProcessSample sample;
+        sample.pid = pid;
+        sample.resident_bytes = resident_bytes(pid);
+
+        quint64 cpu = 0;
+        if (sample.resident_bytes < 0 || !read_cpu_ticks(pid, &cpu))
+            continue;
+
+        auto it = m_previous.constFind(pid);
+        if (it != m_previous.constEnd() && now > it->time && cpu >= it->cpu)
+            sample.cpu_percent = 100.0 * (cpu - it->cpu) / clock_ticks() / ((now - it->time) / 1000.0);
+
+        Ticks ticks;
+        ticks.cpu = cpu;
+        ticks.time = now;
+        current.insert(pid, ticks);
+        samples.append(sample);
+    }
+
+    m_previous = current;
+    return samples;
+}
+
+TaskModel::TaskModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+}
+
+void TaskModel::set_tasks(const QVector<Task> &tasks)
+{
+    bool is_same_processes = tasks.count() == m_tasks.count();
+    for (int i = 0; is_same_processes && i < tasks.count(); i++) {
+        is_same_processes = tasks.at(i).pid == m_tasks.at(i).pid;
+    }
+
+    if (is_same_processes) {
+        for (int i = 0; i < tasks.count(); i++) {
+            m_tasks[i].tabs = tasks.at(i).tabs;
+        }
+        if (!m_tasks.isEmpty())
+            emit dataChanged(index(0, 0), index(m_tasks.count() - 1, 0));
+        return;
+    }
+
+    QHash<qint64, ProcessSample> samples;
+    for (const Task &task : qAsConst(m_tasks)) {
+        samples.insert(task.pid, task.sample);
+    }
+
+    beginResetModel();
+    m_tasks = tasks;
+    for (Task &task : m_tasks) {
+        task.sample = samples.value(task.pid, task.sample);
+    }
+    endResetModel();
+}
+
+void TaskModel::set_samples(const QVector<ProcessSample> &samples)
+{
+    if (m_tasks.isEmpty())
+        return;
+
+    for (const ProcessSample &sample : samples) {
+        auto it = std::find_if(m_tasks.begin(), m_tasks.end(), [&sample] (const Task &task) {
+            return task.pid == sample.pid;
+        });
+        if (it != m_tasks.end())
+            it->sample = sample;
+    }
+
+    emit dataChanged(index(0, 2), index(m_tasks.count() - 1, 3));
+}
+
+const Task &TaskModel::task(int row) const
+{
+    return m_tasks.at(row);
+}
+
+QModelIndex TaskModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+        return QModelIndex();
+
+    return createIndex(row, column);
+}
+
+QModelIndex TaskModel::parent(const QModelIndex &index) const
+{
+    Q_UNUSED(index)
+    return QModelIndex();
+}
+
+int TaskModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_tasks.count();
+}
+
+int TaskModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 4;
+}
+
+QVariant TaskModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    const Task &task = m_tasks.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        switch (index.column()) {
+        case 0: {
+            QStringList titles;
+            for (const QPointer<WebTab> &tab : task.tabs) {
+                if (tab)
+                    titles.append(tab->title());
+            }
+            return titles.join(role == Qt::ToolTipRole ? QStringLiteral("\n") : QStringLiteral(", "));
+        }
+        case 1: return task.pid;
+        case 2:
+            if (task.sample.resident_bytes > 0)
+                return QLocale().formattedDataSize(task.sample.resident_bytes);
+            break;
+        case 3: return QStringLiteral("%1%").arg(task.sample.cpu_percent, 0, 'f', 1);
+        default: break;
+        }
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == 0) {
+            for (const QPointer<WebTab> &tab : task.tabs) {
+                if (tab)
+                    return tab->icon();
+            }
+        }
+        break;
+    case Qt::TextAlignmentRole:
+        if (index.column() > 0)
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        break;
+    }
+
+    return QVariant();
+}
+
+QVariant TaskModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        switch (section) {
+        case 0: return QStringLiteral("Tabs");
+        case 1: return QStringLiteral("Process ID");
+        case 2: return QStringLiteral("Memory");
+        case 3: return QStringLiteral("CPU");
+        }
+    }
+
+    return QAbstractItemModel::headerData(section, orientation, role);
+}
+
+void TaskManagerWidget::refresh()
+{
+    // tabs sharing a renderer are listed together, since memory and CPU are only known per process
+    QVector<Task> tasks;
+    QHash<qint64, int> rows;
+    for (QWidget *widget : QApplication::topLevelWidgets()) {
+        BrowserWindow *window = dynamic_cast<BrowserWindow *>(widget);
+        if (!window)
+            continue;
+
+        for (Tab *tab : window->tabs()) {
+            WebTab *web_tab = dynamic_cast<WebTab *>(tab);
+            if (!web_tab || !web_tab->has_webview())
+                continue;
+
+            const qint64 pid = web_tab->webview()->page()->renderProcessPid();
+            if (pid <= 0)
+                continue;
+
+            if (!rows.contains(pid)) {
+                rows.insert(pid, tasks.count());
+                Task task;
+                task.pid = pid;
+                tasks.append(task);
+            }
+            tasks[rows.value(pid)].tabs.append(web_tab);
+        }
+    }
+
+    std::sort(tasks.begin(), tasks.end(), [] (const Task &a, const Task &b) {
+        return a.pid < b.pid;
+    });
+    m_model->set_tasks(tasks);
+    update_buttons();
+
+    // a slow read never queues up more samples behind it
+    if (!m_worker || m_is_sample_pending || tasks.isEmpty())
+        return;
+
+    QVector<qint64> pids;
+    for (const Task &task : qAsConst(tasks)) {
+        pids.append(task.pid);
+    }
+
+    m_is_sample_pending = true;
+    ProcessSampler *sampler = m_sampler;
+    QPointer<QObject> receiver(this);
+    QMetaObject::invokeMethod(m_worker, [this, sampler, pids, receiver] {
+        const QVector<ProcessSample> samples = sampler->sample(pids);
+        if (QObject *object = receiver.data()) {
+            QMetaObject::invokeMethod(object, [this, samples] {
+                m_is_sample_pending = false;
+                m_model->set_samples(samples);
+            });
+        }
+    });
+}
+
+void TaskManagerWidget::update_buttons()
+{
+    const bool has_selection = m_tree_view->selectionModel()->hasSelection();
+    m_end_process_button->setEnabled(has_selection);
+    m_discard_button->setEnabled(has_selection);
+}
+
+void TaskManagerWidget::end_process()
+{
+    const QModelIndexList indexes = m_tree_view->selectionModel()->selectedRows();
+    for (const QModelIndex &index : indexes) {
+        const Task task = m_model->task(index.row());
+
+        // the sample can be a second old, so make sure the pid still belongs to one of our renderers
+        bool is_renderer = false;
+        for (const QPointer<WebTab> &tab : task.tabs) {
+            if (tab && tab->has_webview() && tab->webview()->page()->renderProcessPid() == task.pid)
+                is_renderer = true;
+        }
+
+#ifdef Q_OS_UNIX
+        if (is_renderer && task.pid > 0)
+            ::kill(task.pid, SIGKILL);
+#endif
+    }
+}
+
+void TaskManagerWidget::discard_tabs()
+{
+    const QModelIndexList indexes = m_tree_view->selectionModel()->selectedRows();
+    for (const QModelIndex &index : indexes) {
+        for (const QPointer<WebTab> &tab : m_model->task(index.row()).tabs) {
+            // a page that is on screen cannot be discarded
+            if (!tab || tab->isVisible())
+                continue;
+
+            if (BrowserWindow *window = dynamic_cast<BrowserWindow *>(tab->window()))
+                window->suspend_tab(tab, QWebEnginePage::LifecycleState::Discarded);
+        }
+    }
+
+    refresh();
+}
+
+void TaskManagerWidget::start_sampler()
+{
+    if (m_thread)
+        return;
+
+    m_thread = new QThread(this);
+    m_thread->setObjectName(QStringLiteral("TaskManager"));
+
+    m_sampler = new ProcessSampler;
+    m_worker = new QObject;
+    m_worker->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread->start();
+}
+
+void TaskManagerWidget::stop_sampler()
+{
+    if (!m_thread)
+        return;
+
+    // a sample still queued is dropped with the worker, so its reply never arrives
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+    delete m_sampler;
+    m_thread = nullptr;
+    m_worker = nullptr;
+    m_sampler = nullptr;
+    m_is_sample_pending = false;
+}
+
+void TaskManagerWidget::showEvent(QShowEvent *event)
+{
+    // the sampler thread only exists while the task manager is on screen
+    start_sampler();
+    refresh();
+    m_sample_timer->start();
+    QWidget::showEvent(event);
+}
+
+void TaskManagerWidget::hideEvent(QHideEvent *event)
+{
+    m_sample_timer->stop();
+    stop_sampler();
+    QWidget::hideEvent(event);
+}
+
+TaskManagerWidget::TaskManagerWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    m_model = new TaskModel(this);
+
+    m_tree_view = new QTreeView;
+    m_tree_view->setModel(m_model);
+    m_tree_view->setRootIsDecorated(false);
+    m_tree_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_tree_view->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_tree_view->header()->setStretchLastSection(false);
+
+    m_end_process_button = new QPushButton(QStringLiteral("End Process"));
+    m_discard_button = new QPushButton(QStringLiteral("Discard Tabs"));
+
+    QHBoxLayout *hbox = new QHBoxLayout;
+    hbox->addStretch();
+    hbox->addWidget(m_discard_button);
+    hbox->addWidget(m_end_process_button);
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    setLayout(vbox);
+    vbox->addWidget(m_tree_view);
+    vbox->addLayout(hbox);
+
+    m_sample_timer = new QTimer(this);
+    m_sample_timer->setInterval(SAMPLE_INTERVAL);
+
+    connect(m_sample_timer, &QTimer::timeout, this, &TaskManagerWidget::refresh);
+    connect(m_tree_view->selectionModel(), &QItemSelectionModel::selectionChanged, this, &TaskManagerWidget::update_buttons);
+    connect(m_end_process_button, &QPushButton::clicked, this, &TaskManagerWidget::end_process);
+    connect(m_discard_button, &QPushButton::clicked, this, &TaskManagerWidget::discard_tabs);
+
+    update_buttons();
+}
+
+TaskManagerWidget::~TaskManagerWidget()
+{
+    stop_sampler();
+}
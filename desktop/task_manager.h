@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QPushButton>
+#include <QTimer>
+#include <QTreeView>
+#include <QVector>
+#include <QWidget>
+
+class QThread;
+class WebTab;
+
+struct ProcessSample
+{
+    qint64 pid = 0;
+    qint64 resident_bytes = 0;
+    double cpu_percent = 0;
+};
+
+class ProcessSampler
+{
+    struct Ticks
+    {
+        quint64 cpu = 0;
+        qint64 time = 0;
+    };
+
+    QHash<qint64, Ticks> m_previous;
+    QElapsedTimer m_clock;
+public:
+    ProcessSampler();
+
+    QVector<ProcessSample> sample(const QVector<qint64> &pids);
+
+    static qint64 resident_bytes(qint64 pid);
+};
+
+struct Task
+{
+    qint64 pid = 0;
+    QList<QPointer<WebTab>> tabs;
+    ProcessSample sample;
+};
+
+class TaskModel : public QAbstractItemModel
+{
+    QVector<Task> m_tasks;
+public:
+    explicit TaskModel(QObject *parent = nullptr);
+
+    void set_tasks(const QVector<Task> &tasks);
+    void set_samples(const QVector<ProcessSample> &samples);
+    const Task &task(int row) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &index) const;
+    int rowCount(const QModelIndex &parent) const;
+    int columnCount(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+};
+
+class TaskManagerWidget : public QWidget
+{
+    QTreeView *m_tree_view = nullptr;
+    QPushButton *m_end_process_button = nullptr;
+    QPushButton *m_discard_button = nullptr;
+    TaskModel *m_model = nullptr;
+    QTimer *m_sample_timer = nullptr;
+    bool m_is_sample_pending = false;
+
+    QThread *m_thread = nullptr;
+    QObject *m_worker = nullptr;
+    ProcessSampler *m_sampler = nullptr;
+
+    void start_sampler();
+    void stop_sampler();
+    void refresh();
+    void update_buttons();
+    void end_process();
+    void discard_tabs();
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+public:
+    explicit TaskManagerWidget(QWidget *parent = nullptr);
+    ~TaskManagerWidget();
+};
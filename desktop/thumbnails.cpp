@@ -0,0 +1,264 @@
+#include "browser.h"
+#include "browser_window.h"
+#include "tab.h"
+#include "thumbnails.h"
+#include "webview.h"
+
+#include <QApplication>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QListWidget>
+#include <QSettings>
+#include <QThread>
+#include <QVBoxLayout>
+
+const int THUMBNAIL_WIDTH = 240;
+const int THUMBNAIL_HEIGHT = 150;
+const int JPEG_QUALITY = 80;
+const int MAX_MEMORY_KB = 32 * 1024;
+const int MAX_FILES = 300;
+
+static bool is_persistent()
+{
+    return QSettings().value(QStringLiteral("tabs/persist_thumbnails"), false).toBool();
+}
+
+ThumbnailCache::ThumbnailCache(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , m_directory(directory)
+{
+    // cost is counted in kilobytes of decoded pixels
+    m_thumbnails.setMaxCost(MAX_MEMORY_KB);
+
+    m_thread = new QThread(this);
+    m_thread->setObjectName(QStringLiteral("ThumbnailCache"));
+
+    m_worker = new QObject;
+    m_worker->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread->start();
+
+    // previews left over from a run that had persistence enabled
+    if (!m_directory.isEmpty() && !is_persistent()) {
+        QMetaObject::invokeMethod(m_worker, [directory] {
+            QDir dir(directory);
+            if (dir.exists())
+                dir.removeRecursively();
+        });
+    }
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    m_thread->quit();
+    m_thread->wait();
+}
+
+QSize ThumbnailCache::size()
+{
+    return QSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT);
+}
+
+void ThumbnailCache::track(WebTab *tab)
+{
+    if (m_tracked.contains(tab))
+        return;
+
+    m_tracked.insert(tab);
+    connect(tab, &QObject::destroyed, this, [this, tab] {
+        m_thumbnails.remove(tab);
+        m_tracked.remove(tab);
+    });
+}
+
+void ThumbnailCache::insert(WebTab *tab, const QImage &image)
+{
+    track(tab);
+    m_thumbnails.insert(tab, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+}
+
+QString ThumbnailCache::file_path(WebTab *tab) const
+{
+    if (m_directory.isEmpty() || tab->url().isEmpty() || !is_persistent())
+        return QString();
+
+    const QByteArray hash = QCryptographicHash::hash(tab->url().toEncoded(), QCryptographicHash::Sha1).toHex();
+    return QDir(m_directory).filePath(QString::fromLatin1(hash) + QStringLiteral(".jpg"));
+}
+
+void ThumbnailCache::capture(WebTab *tab, QObject *context, const std::function<void (const QImage &)> &callback)
+{
+    // hidden, crashed, frozen and discarded tabs keep their last thumbnail
+    if (!tab || !tab->has_webview())
+        return;
+
+    WebView *view = tab->webview();
+    if (!view->isVisible() || view->page()->lifecycleState() != QWebEnginePage::LifecycleState::Active)
+        return;
+
+    const QImage image = view->grab().toImage();
+    if (image.isNull())
+        return;
+
+    track(tab);
+
+    ThumbnailCache *cache = this;
+    QPointer<QObject> guard(this);
+    QPointer<WebTab> target(tab);
+    QPointer<QObject> receiver(context);
+    const QString directory = m_directory;
+    const QString path = file_path(tab);
+    QMetaObject::invokeMethod(m_worker, [cache, guard, target, receiver, callback, image, directory, path] {
+        const QSize bounds = ThumbnailCache::size();
+        const QImage thumbnail = image.scaled(bounds, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation)
+                .copy(QRect(QPoint(0, 0), bounds));
+
+        if (!path.isEmpty()) {
+            QDir dir(directory);
+            dir.mkpath(QStringLiteral("."));
+            if (!thumbnail.save(path, "JPG", JPEG_QUALITY))
+                qDebug() << "Error writing tab thumbnail" << path;
+
+            const QFileInfoList files = dir.entryInfoList(QStringList() << QStringLiteral("*.jpg"), QDir::Files, QDir::Time);
+            for (int i = MAX_FILES; i < files.size(); i++) {
+                QFile::remove(files.at(i).absoluteFilePath());
+            }
+        }
+
+        if (QObject *object = guard.data()) {
+            QMetaObject::invokeMethod(object, [cache, target, receiver, callback, thumbnail] {
+                if (!target)
+                    return;
+                cache->insert(target, thumbnail);
+                if (receiver && callback)
+                    callback(thumbnail);
+            });
+        }
+    });
+}
+
+void ThumbnailCache::load(WebTab *tab, QObject *context, const std::function<void (const QImage &)> &callback)
+{
+    const QImage image = thumbnail(tab);
+    if (!image.isNull()) {
+        callback(image);
+        return;
+    }
+
+    const QString path = file_path(tab);
+    if (path.isEmpty())
+        return;
+
+    ThumbnailCache *cache = this;
+    QPointer<QObject> guard(this);
+    QPointer<WebTab> target(tab);
+    QPointer<QObject> receiver(context);
+    QMetaObject::invokeMethod(m_worker, [cache, guard, target, receiver, callback, path] {
+        const QImage thumbnail(path);
+        if (thumbnail.isNull())
+            return;
+
+        if (QObject *object = guard.data()) {
+            QMetaObject::invokeMethod(object, [cache, target, receiver, callback, thumbnail] {
+                if (!target)
+                    return;
+                // a fresh capture may have landed while the file was read
+                if (cache->thumbnail(target).isNull())
+                    cache->insert(target, thumbnail);
+                if (receiver)
+                    callback(cache->thumbnail(target));
+            });
+        }
+    });
+}
+
+QImage ThumbnailCache::thumbnail(WebTab *tab) const
+{
+    const QImage *image = m_thumbnails.object(tab);
+    return image ? *image : QImage();
+}
+
+void ThumbnailCache::clear()
+{
+    m_thumbnails.clear();
+}
+
+TabOverview::TabOverview(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(QStringLiteral("Tab Overview"));
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(1000, 680);
+
+    const QSize icon_size = ThumbnailCache::size();
+
+    m_list = new QListWidget;
+    m_list->setViewMode(QListView::IconMode);
+    m_list->setMovement(QListView::Static);
+    m_list->setResizeMode(QListView::Adjust);
+    m_list->setUniformItemSizes(true);
+    m_list->setIconSize(icon_size);
+    m_list->setGridSize(icon_size + QSize(24, 40));
+    connect(m_list, &QListWidget::itemClicked, this, &TabOverview::activate);
+    connect(m_list, &QListWidget::itemActivated, this, &TabOverview::activate);
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    vbox->addWidget(m_list);
+    setLayout(vbox);
+
+    for (QWidget *widget : QApplication::topLevelWidgets()) {
+        BrowserWindow *window = dynamic_cast<BrowserWindow *>(widget);
+        if (!window)
+            continue;
+
+        const QList<Tab *> tabs = window->tabs();
+        for (int i = 0; i < tabs.size(); i++) {
+            if (WebTab *tab = dynamic_cast<WebTab *>(tabs.at(i)))
+                add_tab(window, tab, i == window->current_index());
+        }
+    }
+}
+
+void TabOverview::add_tab(BrowserWindow *window, WebTab *tab, bool is_current)
+{
+    QListWidgetItem *item = new QListWidgetItem(tab->icon(), tab->title(), m_list);
+    item->setToolTip(tab->url().toString());
+    m_entries.append({window, tab});
+
+    const auto set_thumbnail = [item] (const QImage &image) {
+        item->setIcon(QIcon(QPixmap::fromImage(image)));
+    };
+
+    // only the visible tab is grabbed, everything else comes from the cache
+    ThumbnailCache *cache = browser->thumbnail_cache();
+    const QImage image = cache->thumbnail(tab);
+    if (!image.isNull())
+        set_thumbnail(image);
+
+    if (is_current)
+        cache->capture(tab, this, set_thumbnail);
+    else if (image.isNull())
+        cache->load(tab, this, set_thumbnail);
+}
+
+void TabOverview::activate(QListWidgetItem *item)
+{
+    const int row = m_list->row(item);
+    if (row < 0 || row >= m_entries.size())
+        return;
+
+    const Entry &entry = m_entries.at(row);
+    if (!entry.window || !entry.tab)
+        return;
+
+    const int index = entry.window->tabs().indexOf(entry.tab.data());
+    if (index == -1)
+        return;
+
+    entry.window->set_current_index(index);
+    entry.window->raise();
+    entry.window->activateWindow();
+    close();
+}
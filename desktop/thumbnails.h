@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QCache>
+#include <QDialog>
+#include <QImage>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QVector>
+
+#include <functional>
+
+class BrowserWindow;
+class QListWidget;
+class QListWidgetItem;
+class QThread;
+class WebTab;
+
+class ThumbnailCache : public QObject
+{
+    QCache<WebTab *, QImage> m_thumbnails;
+    QSet<WebTab *> m_tracked;
+    QString m_directory;
+
+    QThread *m_thread = nullptr;
+    QObject *m_worker = nullptr;
+
+    void track(WebTab *tab);
+    void insert(WebTab *tab, const QImage &image);
+    QString file_path(WebTab *tab) const;
+public:
+    explicit ThumbnailCache(const QString &directory, QObject *parent = nullptr);
+    ~ThumbnailCache();
+
+    static QSize size();
+
+    void capture(WebTab *tab, QObject *context = nullptr, const std::function<void (const QImage &)> &callback = nullptr);
+    void load(WebTab *tab, QObject *context, const std::function<void (const QImage &)> &callback);
+    QImage thumbnail(WebTab *tab) const;
+    void clear();
+};
+
+class TabOverview : public QDialog
+{
+    struct Entry
+    {
+        QPointer<BrowserWindow> window;
+        QPointer<WebTab> tab;
+    };
+
+    QListWidget *m_list = nullptr;
+    QVector<Entry> m_entries;
+
+    void add_tab(BrowserWindow *window, WebTab *tab, bool is_current);
+    void activate(QListWidgetItem *item);
+public:
+    explicit TabOverview(QWidget *parent = nullptr);
+};
@@ -2,7 +2,9 @@
 #include "browser.h"
 #include "browser_window.h"
 #include "history.h"
+#include "history_index.h"
 #include "plugins.h"
+#include "renderer_scheduler.h"
 #include "tab.h"
 #include "webview.h"
 #include "webview_p.h"
@@ -22,14 +24,24 @@ void WebView::show_context_menu(const QPoint &pos)
     menu->exec(mapToGlobal(pos));
 }
 
-void WebView::save_history_entry()
+HistoryEntry WebView::history_entry() const
 {
     HistoryEntry entry;
     entry.title = title();
     entry.address = url().toString();
     entry.icon = icon();
     entry.last_visited = QDateTime::currentDateTime();
-    browser->history_model()->add_entry(entry);
+    return entry;
+}
+
+void WebView::save_history_entry()
+{
+    browser->history_model()->add_entry(history_entry());
+}
+
+void WebView::update_history_entry()
+{
+    browser->history_model()->update_entry(history_entry());
 }
 
 WebView::WebView(QWidget *parent)
@@ -37,13 +49,27 @@ WebView::WebView(QWidget *parent)
 {
     m_webpage = new WebPage(browser->web_profile(), this);
     setPage(m_webpage);
+    connect(m_webpage, &QWebEnginePage::renderProcessPidChanged, browser->renderer_scheduler(), &RendererScheduler::schedule_update);
 
     setContextMenuPolicy(Qt::CustomContextMenu);
 
     connect(this, &WebView::customContextMenuRequested, this, &WebView::show_context_menu);
-    connect(this, &WebView::loadFinished, this, &WebView::save_history_entry);
-    connect(this, &WebView::titleChanged, this, &WebView::save_history_entry);
-    connect(this, &WebView::iconChanged, this, &WebView::save_history_entry);
+    // only a finished navigation counts as a visit, titles and icons arriving later just update the entry
+    connect(this, &WebView::loadFinished, this, [this] (bool ok) {
+        if (ok)
+            save_history_entry();
+    });
+    connect(this, &WebView::titleChanged, this, &WebView::update_history_entry);
+    connect(this, &WebView::iconChanged, this, &WebView::update_history_entry);
+
+    if (HistoryIndexer *indexer = browser->history_indexer()) {
+        connect(this, &WebView::loadStarted, indexer, [this, indexer] {
+            indexer->page_load_started(page());
+        });
+        connect(this, &WebView::loadFinished, indexer, [this, indexer] (bool ok) {
+            indexer->page_load_finished(page(), ok);
+        });
+    }
 }
 
 void WebView::home()
@@ -52,14 +78,35 @@ void WebView::home()
     load(settings.value(QStringLiteral("browsing/homepage"), QStringLiteral("browser:startpage")).toString());
 }
 
-QWebEngineView *WebView::createWindow(QWebEnginePage::WebWindowType type)
+void WebView::adopt_page(WebPage *page, bool is_loaded)
 {
-    QWidget *root = parentWidget();
-    while (root->parentWidget()) {
-        root = root->parentWidget();
+    // setPage deletes an old page the view owns, detach it so the deleteLater below stays valid
+    WebPage *old_page = m_webpage;
+    old_page->setParent(nullptr);
+    m_webpage = page;
+    m_webpage->setParent(this);
+    setPage(m_webpage);
+    connect(m_webpage, &QWebEnginePage::renderProcessPidChanged, browser->renderer_scheduler(), &RendererScheduler::schedule_update);
+    browser->renderer_scheduler()->schedule_update();
+    old_page->deleteLater();
+
+    // a page still loading is recorded by loadFinished like any other navigation
+    if (is_loaded)
+        save_history_entry();
+}
+
+static BrowserWindow *browser_window(QWidget *widget)
+{
+    while (widget && widget->parentWidget()) {
+        widget = widget->parentWidget();
     }
 
-    BrowserWindow *window = dynamic_cast<BrowserWindow *>(root);
+    return dynamic_cast<BrowserWindow *>(widget);
+}
+
+QWebEngineView *WebView::createWindow(QWebEnginePage::WebWindowType type)
+{
+    BrowserWindow *window = browser_window(this);
     if (!window) return nullptr;
 
     WebTab *tab;
@@ -70,8 +117,8 @@ QWebEngineView *WebView::createWindow(QWebEnginePage::WebWindowType type)
         if (!tab) return nullptr;
         return tab->webview();
     case QWebEnginePage::WebBrowserBackgroundTab:
-        tab = dynamic_cast<WebTab *>(window->add_new_tab());
-        if (!tab) return nullptr;
+        // handled by WebPage::createWindow, which keeps the tab a placeholder
+        tab = window->add_background_tab(QUrl());
         return tab->webview();
     case QWebEnginePage::WebBrowserWindow:
         window = browser->create_browser_window();
@@ -97,6 +144,20 @@ WebPage::WebPage(QWebEngineProfile *profile, QObject *parent)
     setWebChannel(channel, QWebEngineScript::ApplicationWorld);
 }
 
+QWebEnginePage *WebPage::createWindow(QWebEnginePage::WebWindowType type)
+{
+    if (type != QWebEnginePage::WebBrowserBackgroundTab)
+        return QWebEnginePage::createWindow(type);
+
+    BrowserWindow *window = browser_window(view());
+    if (!window) return nullptr;
+
+    // the popup loads into a page without a view, the tab adopts it once it is first shown
+    WebPage *page = new WebPage(profile(), nullptr);
+    window->add_background_tab(QUrl())->set_pending_page(page);
+    return page;
+}
+
 bool WebPage::acceptNavigationRequest(const QUrl &url, QWebEnginePage::NavigationType type, bool isMainFrame)
 {
     Q_UNUSED(type)
@@ -5,16 +5,20 @@
 #include <QWebEngineView>
 #include <QWebEngineUrlRequestInterceptor>
 
+struct HistoryEntry;
 class WebPage;
 
 class WebView : public QWebEngineView
 {
     WebPage *m_webpage = nullptr;
     void show_context_menu(const QPoint &pos);
+    HistoryEntry history_entry() const;
     void save_history_entry();
+    void update_history_entry();
 public:
     explicit WebView(QWidget *parent = nullptr);
     void home();
+    void adopt_page(WebPage *page, bool is_loaded = true);
 
     QWebEngineView * createWindow(QWebEnginePage::WebWindowType type) override;
 };
@@ -24,4 +28,5 @@ class WebPage : public QWebEnginePage
 public:
     explicit WebPage(QWebEngineProfile *profile, QObject *parent);
     bool acceptNavigationRequest(const QUrl &url, NavigationType type, bool isMainFrame) override;
+    QWebEnginePage *createWindow(WebWindowType type) override;
 };
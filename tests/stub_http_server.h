@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+
+#include <functional>
+
+struct StubResponse
+{
+    int status = 200;
+    QByteArray body;
+    QByteArray location;
+};
+
+// A local stand-in for remote HTTP services, answers every request with the response from the handler.
+class StubHttpServer : public QTcpServer
+{
+    std::function<QByteArray (const QUrl &)> m_handler;
+    std::function<StubResponse (const QByteArray &, const QUrl &)> m_responder;
+    QByteArray m_content_type = "application/json";
+    int m_delay = 0;
+    int m_active = 0;
+    int m_peak_active = 0;
+    QList<QUrl> m_requests;
+    QList<QByteArray> m_methods;
+
+    void handle(QTcpSocket *socket)
+    {
+        if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n"))
+            return;
+
+        const QList<QByteArray> request_line = socket->readAll().split('\n').first().split(' ');
+        if (request_line.count() < 2)
+            return;
+
+        const QByteArray method = request_line.at(0);
+        const QUrl url(QStringLiteral("http://127.0.0.1:%1").arg(serverPort()) + QString::fromLatin1(request_line.at(1)));
+        m_requests.append(url);
+        m_methods.append(method);
+
+        StubResponse response;
+        if (m_responder)
+            response = m_responder(method, url);
+        else if (m_handler)
+            response.body = m_handler(url);
+
+        m_active++;
+        m_peak_active = qMax(m_peak_active, m_active);
+
+        const QByteArray content_type = m_content_type;
+        QTimer::singleShot(m_delay, socket, [this, socket, method, response, content_type] {
+            m_active--;
+
+            QByteArray headers = "HTTP/1.1 " + QByteArray::number(response.status) + " Stub\r\nContent-Type: " + content_type
+                    + "\r\nContent-Length: " + QByteArray::number(response.body.size()) + "\r\nConnection: close\r\n";
+            if (!response.location.isEmpty())
+                headers += "Location: " + response.location + "\r\n";
+
+            socket->write(headers + "\r\n" + (method == "HEAD" ? QByteArray() : response.body));
+            socket->disconnectFromHost();
+        });
+    }
+public:
+    explicit StubHttpServer(QObject *parent = nullptr)
+        : QTcpServer(parent)
+    {
+        connect(this, &QTcpServer::newConnection, this, [this] {
+            while (QTcpSocket *socket = nextPendingConnection()) {
+                connect(socket, &QTcpSocket::readyRead, socket, [this, socket] { handle(socket); });
+                connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    }
+
+    bool start()
+    {
+        return listen(QHostAddress::LocalHost);
+    }
+
+    QString url(const QString &path) const
+    {
+        return QStringLiteral("http://127.0.0.1:%1").arg(serverPort()) + path;
+    }
+
+    void set_handler(const std::function<QByteArray (const QUrl &)> &handler)
+    {
+        m_handler = handler;
+    }
+
+    void set_responder(const std::function<StubResponse (const QByteArray &, const QUrl &)> &responder)
+    {
+        m_responder = responder;
+    }
+
+    void set_content_type(const QByteArray &content_type)
+    {
+        m_content_type = content_type;
+    }
+
+    void set_delay(int msecs)
+    {
+        m_delay = msecs;
+    }
+
+    QList<QUrl> requests() const
+    {
+        return m_requests;
+    }
+
+    QList<QByteArray> methods() const
+    {
+        return m_methods;
+    }
+
+    int peak_active() const
+    {
+        return m_peak_active;
+    }
+
+    void reset_peak_active()
+    {
+        m_peak_active = m_active;
+    }
+};
@@ -0,0 +1,197 @@
+#include "test_bookmarks.h"
+#include "bookmark_cache.h"
+#include "bookmarks.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QStandardPaths>
+
+const int BENCHMARK_ENTRIES = 100000;
+
+static bool rows_match(const BookmarkTreeNode *node)
+{
+    for (int i = 0; i < node->children.count(); i++) {
+        if (node->children.at(i)->row != i || node->children.at(i)->parent != node)
+            return false;
+    }
+    return true;
+}
+
+static bool same_tree(const BookmarkTreeNode *a, const BookmarkTreeNode *b)
+{
+    if (a->type != b->type || a->title != b->title || a->address != b->address || a->desc != b->desc
+            || a->children.count() != b->children.count()) {
+        return false;
+    }
+
+    for (int i = 0; i < a->children.count(); i++) {
+        if (!same_tree(a->children.at(i), b->children.at(i)))
+            return false;
+    }
+    return true;
+}
+
+static BookmarkTreeNode *create_tree(int count)
+{
+    BookmarkTreeNode *root = new BookmarkTreeNode(BookmarkTreeNode::Root);
+    BookmarkTreeNode *folder = nullptr;
+    for (int i = 0; i < count; i++) {
+        if (i % 1000 == 0) {
+            folder = new BookmarkTreeNode(BookmarkTreeNode::Folder, root);
+            folder->title = QStringLiteral("Folder %1").arg(i / 1000);
+        }
+
+        BookmarkTreeNode *node = new BookmarkTreeNode(BookmarkTreeNode::Address, folder);
+        node->title = QStringLiteral("Bookmark %1").arg(i);
+        node->address = QStringLiteral("https://example.com/pages/%1").arg(i);
+        node->desc = i % 10 == 0 ? QStringLiteral("Every tenth bookmark") : QString();
+    }
+    return root;
+}
+
+static void write_snapshot(const QString &xbel_path, const QString &cache_path, BookmarkTreeNode *root)
+{
+    QByteArray xbel;
+    QBuffer buffer(&xbel);
+    buffer.open(QBuffer::WriteOnly);
+    XbelWriter writer;
+    writer.write(&buffer, root);
+
+    QFile file(xbel_path);
+    QVERIFY(file.open(QFile::WriteOnly));
+    file.write(xbel);
+    file.close();
+
+    QVERIFY(BookmarkCache::write(cache_path, BookmarkCache::serialize(root, BookmarkCacheInfo()), xbel));
+}
+
+void TestBookmarks::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    QStandardPaths::setTestModeEnabled(true);
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    dir.remove(QStringLiteral("bookmarks.xbel"));
+    dir.remove(QStringLiteral("bookmarks.journal"));
+}
+
+void TestBookmarks::test_row_tracking()
+{
+    BookmarkTreeNode root;
+    BookmarkTreeNode *folder = new BookmarkTreeNode(BookmarkTreeNode::Folder, &root);
+    for (int i = 0; i < 10; i++) {
+        new BookmarkTreeNode(BookmarkTreeNode::Address, folder);
+    }
+    QVERIFY(rows_match(folder));
+
+    BookmarkTreeNode *moved = folder->children.at(3);
+    root.insert(moved, 0);
+    QCOMPARE(moved->row, 0);
+    QCOMPARE(folder->row, 1);
+    QCOMPARE(folder->children.count(), 9);
+    QVERIFY(rows_match(folder));
+    QVERIFY(rows_match(&root));
+
+    delete folder->children.at(0);
+    folder->insert(new BookmarkTreeNode(BookmarkTreeNode::Address), 4);
+    QCOMPARE(folder->children.count(), 9);
+    QVERIFY(rows_match(folder));
+}
+
+void TestBookmarks::benchmark_flat_folder()
+{
+    BookmarkModel model;
+    BookmarkTreeNode *folder = new BookmarkTreeNode(BookmarkTreeNode::Folder);
+    folder->title = QStringLiteral("Flat");
+    model.add_bookmark(nullptr, folder);
+
+    for (int i = 0; i < BENCHMARK_ENTRIES; i++) {
+        BookmarkTreeNode *node = new BookmarkTreeNode(BookmarkTreeNode::Address, folder);
+        node->address = QStringLiteral("https://example.com/%1").arg(i);
+    }
+
+    const QModelIndex folder_index = model.index(folder->row, 0);
+    QCOMPARE(model.rowCount(folder_index), BENCHMARK_ENTRIES);
+
+    int mismatches = 0;
+    for (int i = 0; i < BENCHMARK_ENTRIES; i++) {
+        const QModelIndex index = model.index(i, 0, folder_index);
+        if (model.parent(index) != folder_index)
+            mismatches++;
+    }
+    QCOMPARE(mismatches, 0);
+
+    for (int i = 0; i < 100; i++) {
+        delete folder->children.at(BENCHMARK_ENTRIES / 2);
+    }
+    QVERIFY(rows_match(folder));
+
+    // what a view does while painting: an index and its parent for every visible row
+    const int rows = model.rowCount(folder_index);
+    QBENCHMARK {
+        for (int i = 0; i < rows; i++) {
+            model.parent(model.index(i, 0, folder_index));
+        }
+    }
+}
+
+void TestBookmarks::test_cache_validation()
+{
+    const QString xbel_path = m_dir.filePath(QStringLiteral("validation.xbel"));
+    const QString cache_path = m_dir.filePath(QStringLiteral("validation.cache"));
+
+    QScopedPointer<BookmarkTreeNode> root(create_tree(50));
+    write_snapshot(xbel_path, cache_path, root.data());
+
+    BookmarkCacheInfo info;
+    QScopedPointer<BookmarkTreeNode> cached(BookmarkCache::read(cache_path, xbel_path, &info));
+    QVERIFY(cached);
+    QVERIFY(same_tree(cached.data(), root.data()));
+    QCOMPARE(cached->children.at(0)->children.at(10)->desc, QStringLiteral("Every tenth bookmark"));
+
+    // an XBEL file changed behind the cache's back must not be shadowed by it
+    QFile file(xbel_path);
+    QVERIFY(file.open(QFile::ReadWrite));
+    file.seek(file.size() - 2);
+    file.write("  ");
+    file.close();
+    QVERIFY(!BookmarkCache::read(cache_path, xbel_path, &info));
+}
+
+void TestBookmarks::benchmark_cached_load_data()
+{
+    QTest::addColumn<bool>("is_cached");
+
+    QTest::newRow("xbel") << false;
+    QTest::newRow("cache") << true;
+}
+
+void TestBookmarks::benchmark_cached_load()
+{
+    QFETCH(bool, is_cached);
+
+    const QString xbel_path = m_dir.filePath(QStringLiteral("benchmark.xbel"));
+    const QString cache_path = m_dir.filePath(QStringLiteral("benchmark.cache"));
+
+    QScopedPointer<BookmarkTreeNode> root(create_tree(BENCHMARK_ENTRIES));
+    write_snapshot(xbel_path, cache_path, root.data());
+
+    XbelReader reader;
+    QScopedPointer<BookmarkTreeNode> parsed(reader.read(xbel_path));
+
+    QScopedPointer<BookmarkTreeNode> loaded;
+    QBENCHMARK {
+        if (is_cached) {
+            BookmarkCacheInfo info;
+            loaded.reset(BookmarkCache::read(cache_path, xbel_path, &info));
+        } else {
+            XbelReader xbel_reader;
+            loaded.reset(xbel_reader.read(xbel_path));
+        }
+    }
+
+    QVERIFY(loaded);
+    QVERIFY(same_tree(loaded.data(), parsed.data()));
+}
+
+QTEST_MAIN(TestBookmarks)
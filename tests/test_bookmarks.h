@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QtTest>
+
+class TestBookmarks : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void test_row_tracking();
+    void benchmark_flat_folder();
+    void test_cache_validation();
+    void benchmark_cached_load_data();
+    void benchmark_cached_load();
+private:
+    QTemporaryDir m_dir;
+};
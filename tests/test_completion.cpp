@@ -0,0 +1,166 @@
+#include "test_completion.h"
+#include "completion.h"
+
+const int BENCHMARK_ENTRIES = 500000;
+const int BASELINE_ENTRIES = BENCHMARK_ENTRIES / 10;
+const int TIMING_RUNS = 5;
+const int MAX_SLOWDOWN = 4;
+
+static CompletionSource source(const QString &address, const QString &title, int visit_count, int days_ago)
+{
+    CompletionSource source;
+    source.address = address;
+    source.title = title;
+    source.visit_count = visit_count;
+    source.last_visited = QDateTime::currentDateTime().addDays(-days_ago);
+    return source;
+}
+
+void TestCompletion::test_prefix_match()
+{
+    CompletionIndex index;
+    index.build(QVector<CompletionSource> {
+        source(QStringLiteral("https://www.example.com/"), QStringLiteral("Example Domain"), 1, 0),
+        source(QStringLiteral("https://qt.io/"), QStringLiteral("Qt Cross-platform Framework"), 1, 0),
+    });
+
+    QCOMPARE(index.complete(QStringLiteral("exa"), 10).count(), 1);
+    QCOMPARE(index.complete(QStringLiteral("https://www.exa"), 10).count(), 1);
+    QCOMPARE(index.complete(QStringLiteral("EXAMPLE.COM"), 10).count(), 1);
+    QCOMPARE(index.complete(QStringLiteral("www"), 10).count(), 0);
+
+    const QVector<Completion> completions = index.complete(QStringLiteral("cross"), 10);
+    QCOMPARE(completions.count(), 1);
+    QCOMPARE(completions.at(0).address, QStringLiteral("https://qt.io/"));
+    QCOMPARE(index.complete(QStringLiteral("platform fr"), 10).count(), 1);
+}
+
+void TestCompletion::test_frecency_order()
+{
+    CompletionIndex index;
+    index.build(QVector<CompletionSource> {
+        source(QStringLiteral("https://example.com/old"), QStringLiteral("Old"), 10, 365),
+        source(QStringLiteral("https://example.com/frequent"), QStringLiteral("Frequent"), 50, 2),
+        source(QStringLiteral("https://example.com/recent"), QStringLiteral("Recent"), 1, 0),
+    });
+
+    const QVector<Completion> completions = index.complete(QStringLiteral("example"), 10);
+    QCOMPARE(completions.count(), 3);
+    QCOMPARE(completions.at(0).title, QStringLiteral("Frequent"));
+    QCOMPARE(completions.at(1).title, QStringLiteral("Recent"));
+    QCOMPARE(completions.at(2).title, QStringLiteral("Old"));
+}
+
+void TestCompletion::test_incremental_update()
+{
+    CompletionIndex index;
+    index.build(QVector<CompletionSource> {
+        source(QStringLiteral("https://example.com/a"), QStringLiteral("A"), 5, 1),
+        source(QStringLiteral("https://example.com/b"), QStringLiteral("B"), 1, 1),
+    });
+
+    for (int i = 0; i < 10; i++) {
+        index.add_visit(QStringLiteral("https://example.com/b"), QStringLiteral("B"), QDateTime::currentDateTime());
+    }
+    QCOMPARE(index.complete(QStringLiteral("example"), 10).at(0).title, QStringLiteral("B"));
+
+    index.add_visit(QStringLiteral("https://example.com/c"), QStringLiteral("C"), QDateTime::currentDateTime());
+    QCOMPARE(index.complete(QStringLiteral("example"), 10).count(), 3);
+
+    index.remove(QStringLiteral("https://example.com/b"));
+    QCOMPARE(index.complete(QStringLiteral("example"), 10).count(), 2);
+
+    // a title arriving after the visit renames the entry instead of adding another one
+    index.set_title(QStringLiteral("https://example.com/a"), QStringLiteral("Renamed"));
+    QCOMPARE(index.complete(QStringLiteral("renamed"), 10).count(), 1);
+    QCOMPARE(index.complete(QStringLiteral("example"), 10).count(), 2);
+
+    index.set_bookmarked(QStringLiteral("https://bookmark.example.org/"), QStringLiteral("Bookmark"), true);
+    QVERIFY(index.complete(QStringLiteral("bookmark"), 10).at(0).is_bookmark);
+
+    index.set_bookmarked(QStringLiteral("https://bookmark.example.org/"), QStringLiteral("Bookmark"), false);
+    QCOMPARE(index.complete(QStringLiteral("bookmark"), 10).count(), 0);
+
+    // enough new entries to move them out of the delta into the sorted keys
+    for (int i = 0; i < 5000; i++) {
+        index.add_visit(QStringLiteral("https://merged.example.net/%1").arg(i), QStringLiteral("Merged %1").arg(i), QDateTime::currentDateTime());
+    }
+    index.add_visit(QStringLiteral("https://merged.example.net/42"), QStringLiteral("Merged 42"), QDateTime::currentDateTime().addSecs(3600));
+    QCOMPARE(index.complete(QStringLiteral("merged"), 1).at(0).title, QStringLiteral("Merged 42"));
+    QCOMPARE(index.count(), 5002);
+}
+
+void TestCompletion::test_inline_completion()
+{
+    CompletionIndex index;
+    index.build(QVector<CompletionSource> {
+        source(QStringLiteral("https://www.example.com/Path/Page"), QStringLiteral("Example"), 1, 0),
+    });
+
+    QCOMPARE(index.inline_completion(QStringLiteral("exa")), QStringLiteral("mple.com/"));
+    QCOMPARE(index.inline_completion(QStringLiteral("https://www.exa")), QStringLiteral("mple.com/"));
+    QCOMPARE(index.inline_completion(QStringLiteral("example.com/p")), QStringLiteral("ath/Page"));
+    QCOMPARE(index.inline_completion(QStringLiteral("example ")), QString());
+    QCOMPARE(index.inline_completion(QStringLiteral("other")), QString());
+}
+
+static QVector<CompletionSource> create_sources(int count)
+{
+    QVector<CompletionSource> sources;
+    sources.reserve(count);
+    for (int i = 0; i < count; i++) {
+        sources.append(source(QStringLiteral("https://www.site%1.example.com/articles/%2").arg(i % 20000).arg(i),
+                              QStringLiteral("Article %1 about topic %2 and news").arg(i).arg(i % 1000),
+                              1 + i % 7, i % 400));
+    }
+    return sources;
+}
+
+// best of several runs of typing every prefix of every string, one keystroke at a time
+static qint64 typing_nsecs(const CompletionIndex &index, const QStringList &typed)
+{
+    qint64 best = -1;
+    for (int run = 0; run < TIMING_RUNS; run++) {
+        QElapsedTimer timer;
+        timer.start();
+        for (const QString &text : typed) {
+            for (int length = 1; length <= text.length(); length++) {
+                index.complete(text.left(length), 10);
+                index.inline_completion(text.left(length));
+            }
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+        best = best == -1 ? elapsed : qMin(best, elapsed);
+    }
+    return best;
+}
+
+void TestCompletion::benchmark_complete()
+{
+    CompletionIndex index;
+    index.build(create_sources(BENCHMARK_ENTRIES));
+    QCOMPARE(index.count(), BENCHMARK_ENTRIES);
+
+    CompletionIndex baseline;
+    baseline.build(create_sources(BASELINE_ENTRIES));
+
+    const QStringList typed {
+        QStringLiteral("site1234.example.com/articles"),
+        QStringLiteral("https://www.site9"),
+        QStringLiteral("article 4242"),
+        QStringLiteral("topic 17 and"),
+    };
+
+    // a linear scan would be about ten times slower on the larger index, wall-clock limits are left to the report
+    const qint64 baseline_nsecs = typing_nsecs(baseline, typed);
+    const qint64 nsecs = typing_nsecs(index, typed);
+    qDebug() << BASELINE_ENTRIES << "entries" << baseline_nsecs / 1000 << "us," << BENCHMARK_ENTRIES << "entries" << nsecs / 1000 << "us";
+    QVERIFY2(nsecs < qMax<qint64>(baseline_nsecs, 1000000) * MAX_SLOWDOWN,
+             qPrintable(QStringLiteral("%1 ns against %2 ns for a ten times smaller index").arg(nsecs).arg(baseline_nsecs)));
+
+    QBENCHMARK {
+        index.complete(QStringLiteral("s"), 10);
+    }
+}
+
+QTEST_MAIN(TestCompletion)
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtTest>
+
+class TestCompletion : public QObject
+{
+    Q_OBJECT
+private slots:
+    void test_prefix_match();
+    void test_frecency_order();
+    void test_incremental_update();
+    void test_inline_completion();
+    void benchmark_complete();
+};
@@ -0,0 +1,129 @@
+#include "test_database.h"
+#include "database.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+void TestDatabase::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void TestDatabase::test_read_after_write()
+{
+    Database database(m_dir.filePath(QStringLiteral("read_after_write")));
+    for (int i = 0; i < 100; i++) {
+        database.write(QStringLiteral("REPLACE INTO history (title, address, last_visited) VALUES (?, ?, ?)"),
+                       QVariantList { QStringLiteral("Title"), QStringLiteral("https://example.com/%1").arg(i), QDateTime::currentDateTime() });
+    }
+
+    int count = -1;
+    database.read<int>([] (DatabaseWorker *db) {
+        int count = 0;
+        db->exec(QStringLiteral("SELECT COUNT(*) FROM history"), QVariantList(), [&count] (QSqlQuery &query) {
+            if (query.next())
+                count = query.value(0).toInt();
+        });
+        return count;
+    }, this, [&count] (const int &result) {
+        count = result;
+    });
+
+    QTRY_COMPARE(count, 100);
+}
+
+static QString content_match(Database *database, const QString &term)
+{
+    QString address;
+    bool is_done = false;
+    database->read<QString>([term] (DatabaseWorker *db) {
+        QString address;
+        db->exec(QStringLiteral("SELECT c.address FROM history_fts JOIN history_content c ON c.id = history_fts.rowid "
+                                "WHERE history_fts MATCH ?"), QVariantList { term }, [&address] (QSqlQuery &query) {
+            if (query.next())
+                address = query.value(0).toString();
+        });
+        return address;
+    }, database, [&address, &is_done] (const QString &result) {
+        address = result;
+        is_done = true;
+    });
+
+    QTest::qWaitFor([&is_done] { return is_done; });
+    return address;
+}
+
+void TestDatabase::test_content_migration()
+{
+    const QString path = m_dir.filePath(QStringLiteral("content_migration"));
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("content_migration"));
+        database.setDatabaseName(path);
+        QVERIFY(database.open());
+
+        // a version 3 profile whose first page was removed, leaving a gap in the implicit rowids
+        QSqlQuery query(database);
+        QVERIFY(query.exec(QStringLiteral("CREATE TABLE history (title TEXT, address TEXT UNIQUE, icon BLOB, last_visited DATETIME, "
+                                          "visit_count INTEGER NOT NULL DEFAULT 1)")));
+        QVERIFY(query.exec(QStringLiteral("CREATE TABLE history_content (address TEXT UNIQUE, title TEXT, content BLOB, visited DATETIME)")));
+        QVERIFY(query.exec(QStringLiteral("CREATE VIRTUAL TABLE history_fts USING fts5(title, content, content='')")));
+        QVERIFY(query.exec(QStringLiteral("INSERT INTO history_content (address, title) VALUES ('https://example.com/1', 'first'), "
+                                          "('https://example.com/2', 'second')")));
+        QVERIFY(query.exec(QStringLiteral("INSERT INTO history_fts (rowid, title, content) VALUES (1, 'first', ''), (2, 'second', '')")));
+        QVERIFY(query.exec(QStringLiteral("INSERT INTO history_fts (history_fts, rowid, title, content) VALUES ('delete', 1, 'first', '')")));
+        QVERIFY(query.exec(QStringLiteral("DELETE FROM history_content WHERE rowid = 1")));
+        QVERIFY(query.exec(QStringLiteral("PRAGMA user_version = 3")));
+
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("content_migration"));
+
+    Database database(path);
+    QCOMPARE(content_match(&database, QStringLiteral("second")), QStringLiteral("https://example.com/2"));
+
+    database.run([] (DatabaseWorker *db) {
+        db->exec(QStringLiteral("VACUUM"));
+    });
+    QCOMPARE(content_match(&database, QStringLiteral("second")), QStringLiteral("https://example.com/2"));
+}
+
+void TestDatabase::benchmark_synchronous_write()
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("synchronous"));
+        database.setDatabaseName(m_dir.filePath(QStringLiteral("synchronous")));
+        QVERIFY(database.open());
+
+        QSqlQuery query(database);
+        QVERIFY(query.exec(QStringLiteral("CREATE TABLE history (title TEXT, address TEXT UNIQUE, icon BLOB, last_visited DATETIME)")));
+
+        int i = 0;
+        QBENCHMARK {
+            QSqlQuery query(database);
+            query.prepare(QStringLiteral("REPLACE INTO history (title, address, last_visited) VALUES (?, ?, ?)"));
+            query.addBindValue(QStringLiteral("Title"));
+            query.addBindValue(QStringLiteral("https://example.com/%1").arg(i++));
+            query.addBindValue(QDateTime::currentDateTime());
+            QVERIFY(query.exec());
+        }
+
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("synchronous"));
+}
+
+void TestDatabase::benchmark_queued_write()
+{
+    Database database(m_dir.filePath(QStringLiteral("queued")));
+    database.wait();
+
+    int i = 0;
+    QBENCHMARK {
+        database.write(QStringLiteral("REPLACE INTO history (title, address, last_visited) VALUES (?, ?, ?)"),
+                       QVariantList { QStringLiteral("Title"), QStringLiteral("https://example.com/%1").arg(i++), QDateTime::currentDateTime() });
+    }
+
+    database.wait();
+}
+
+QTEST_MAIN(TestDatabase)
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QtTest>
+
+class TestDatabase : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir m_dir;
+private slots:
+    void initTestCase();
+    void test_read_after_write();
+    void test_content_migration();
+    void benchmark_synchronous_write();
+    void benchmark_queued_write();
+};
@@ -0,0 +1,178 @@
+#include "test_history_import.h"
+#include "database.h"
+#include "history_import.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+const int FIXTURE_ROWS = 1201;
+
+static bool write_fixture(const QString &path, const QStringList &schema, const QString &insert, const QVector<QVariantList> &rows)
+{
+    bool is_written = true;
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("fixture"));
+        database.setDatabaseName(path);
+        is_written = database.open() && database.transaction();
+
+        QSqlQuery query(database);
+        for (const QString &statement : schema) {
+            is_written = is_written && query.exec(statement);
+        }
+
+        is_written = is_written && query.prepare(insert);
+        for (const QVariantList &row : rows) {
+            for (int i = 0; i < row.count(); i++) {
+                query.bindValue(i, row.at(i));
+            }
+            is_written = is_written && query.exec();
+        }
+
+        is_written = is_written && database.commit();
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("fixture"));
+    return is_written;
+}
+
+static HistoryImportResult import_history(Database *database, const QString &path)
+{
+    HistoryImportResult result;
+    bool is_done = false;
+    HistoryImporter importer(database);
+    importer.import(path, database, [&result, &is_done] (const HistoryImportResult &imported) {
+        result = imported;
+        is_done = true;
+    });
+
+    QTest::qWaitFor([&is_done] { return is_done; });
+    return result;
+}
+
+static QVariantList history_entry(Database *database, const QString &address)
+{
+    QVariantList entry;
+    bool is_done = false;
+    database->read<QVariantList>([address] (DatabaseWorker *db) {
+        QVariantList entry;
+        db->exec(QStringLiteral("SELECT title, last_visited, visit_count FROM history WHERE address = ?"), QVariantList { address }, [&entry] (QSqlQuery &query) {
+            if (query.next())
+                entry = QVariantList { query.value(0), query.value(1), query.value(2) };
+        });
+        return entry;
+    }, database, [&entry, &is_done] (const QVariantList &result) {
+        entry = result;
+        is_done = true;
+    });
+
+    QTest::qWaitFor([&is_done] { return is_done; });
+    return entry;
+}
+
+static int history_count(Database *database)
+{
+    int count = -1;
+    bool is_done = false;
+    database->read<int>([] (DatabaseWorker *db) {
+        int count = 0;
+        db->exec(QStringLiteral("SELECT COUNT(*) FROM history"), QVariantList(), [&count] (QSqlQuery &query) {
+            if (query.next())
+                count = query.value(0).toInt();
+        });
+        return count;
+    }, database, [&count, &is_done] (const int &result) {
+        count = result;
+        is_done = true;
+    });
+
+    QTest::qWaitFor([&is_done] { return is_done; });
+    return count;
+}
+
+void TestHistoryImport::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void TestHistoryImport::test_firefox_import()
+{
+    const QDateTime visited = QDateTime::currentDateTime().addDays(-1);
+
+    // enough rows for several chunks, plus pages the importer has to skip
+    QVector<QVariantList> rows;
+    for (int i = 0; i < FIXTURE_ROWS; i++) {
+        rows.append(QVariantList { QStringLiteral("https://example.com/%1").arg(i), QStringLiteral("Page %1").arg(i),
+                                   visited.toMSecsSinceEpoch() * 1000, i % 5, 0 });
+    }
+    rows.append(QVariantList { QStringLiteral("about:config"), QStringLiteral("Config"), visited.toMSecsSinceEpoch() * 1000, 3, 0 });
+    rows.append(QVariantList { QStringLiteral("https://example.org/hidden"), QStringLiteral("Hidden"), visited.toMSecsSinceEpoch() * 1000, 3, 1 });
+
+    const QString fixture = m_dir.filePath(QStringLiteral("places.sqlite"));
+    QVERIFY(write_fixture(fixture, QStringList {
+        QStringLiteral("CREATE TABLE moz_places (id INTEGER PRIMARY KEY, url TEXT, title TEXT, last_visit_date INTEGER, "
+                       "visit_count INTEGER, hidden INTEGER)"),
+    }, QStringLiteral("INSERT INTO moz_places (url, title, last_visit_date, visit_count, hidden) VALUES (?, ?, ?, ?, ?)"), rows));
+
+    Database database(m_dir.filePath(QStringLiteral("firefox")));
+    // an older visit is merged, a newer one is kept as it is
+    database.write(QStringLiteral("INSERT INTO history (title, address, last_visited, visit_count) VALUES (?, ?, ?, ?)"),
+                   QVariantList { QStringLiteral("Old"), QStringLiteral("https://example.com/3"), visited.addDays(-1), 1 });
+    database.write(QStringLiteral("INSERT INTO history (title, address, last_visited, visit_count) VALUES (?, ?, ?, ?)"),
+                   QVariantList { QStringLiteral("Kept"), QStringLiteral("https://example.com/4"), visited.addDays(1), 2 });
+
+    bool is_import_done = false;
+    bool is_read_first = false;
+    HistoryImporter importer(&database);
+    importer.import(fixture, this, [&is_import_done] (const HistoryImportResult &) {
+        is_import_done = true;
+    });
+    database.read<int>([] (DatabaseWorker *) { return 0; }, this, [&is_import_done, &is_read_first] (const int &) {
+        is_read_first = !is_import_done;
+    });
+    QTRY_VERIFY(is_import_done);
+    // the read queued behind the import runs between its chunks instead of after all of them
+    QVERIFY(is_read_first);
+
+    QCOMPARE(history_count(&database), FIXTURE_ROWS);
+
+    const QVariantList merged = history_entry(&database, QStringLiteral("https://example.com/3"));
+    QCOMPARE(merged.value(0).toString(), QStringLiteral("Page 3"));
+    QCOMPARE(merged.value(2).toInt(), 3);
+
+    const QVariantList kept = history_entry(&database, QStringLiteral("https://example.com/4"));
+    QCOMPARE(kept.value(0).toString(), QStringLiteral("Kept"));
+    QCOMPARE(kept.value(2).toInt(), 2);
+
+    // places that were never counted still have one visit
+    QCOMPARE(history_entry(&database, QStringLiteral("https://example.com/0")).value(2).toInt(), 1);
+    QCOMPARE(history_entry(&database, QStringLiteral("https://example.com/1200")).value(2).toInt(), 1);
+    QVERIFY(history_entry(&database, QStringLiteral("https://example.org/hidden")).isEmpty());
+}
+
+void TestHistoryImport::test_chromium_import()
+{
+    const QDateTime visited = QDateTime::fromString(QStringLiteral("2020-05-01T12:00:00Z"), Qt::ISODate);
+    const qint64 chromium_time = (visited.toMSecsSinceEpoch() + Q_INT64_C(11644473600000)) * 1000;
+
+    const QString fixture = m_dir.filePath(QStringLiteral("History"));
+    QVERIFY(write_fixture(fixture, QStringList {
+        QStringLiteral("CREATE TABLE urls (id INTEGER PRIMARY KEY, url TEXT, title TEXT, visit_count INTEGER, "
+                       "last_visit_time INTEGER, hidden INTEGER)"),
+    }, QStringLiteral("INSERT INTO urls (url, title, visit_count, last_visit_time, hidden) VALUES (?, ?, ?, ?, ?)"), QVector<QVariantList> {
+        { QStringLiteral("https://example.com/"), QStringLiteral("Example"), 7, chromium_time, 0 },
+        { QStringLiteral("chrome://settings/"), QStringLiteral("Settings"), 2, chromium_time, 0 },
+        { QStringLiteral("https://example.com/never"), QStringLiteral("Never"), 1, 0, 0 },
+    }));
+
+    Database database(m_dir.filePath(QStringLiteral("chromium")));
+    const HistoryImportResult result = import_history(&database, fixture);
+    QVERIFY(result.error.isEmpty());
+    QCOMPARE(result.imported, 1);
+    QCOMPARE(history_count(&database), 1);
+
+    const QVariantList entry = history_entry(&database, QStringLiteral("https://example.com/"));
+    QCOMPARE(entry.value(1).toDateTime().toMSecsSinceEpoch(), visited.toMSecsSinceEpoch());
+    QCOMPARE(entry.value(2).toInt(), 7);
+}
+
+QTEST_MAIN(TestHistoryImport)
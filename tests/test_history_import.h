@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtTest>
+
+class TestHistoryImport : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir m_dir;
+private slots:
+    void initTestCase();
+    void test_firefox_import();
+    void test_chromium_import();
+};
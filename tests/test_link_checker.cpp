@@ -0,0 +1,120 @@
+#include "test_link_checker.h"
+#include "link_checker.h"
+
+static void check_all(LinkChecker &checker, const QStringList &addresses, QObject *context, QHash<QString, LinkCheckResult> *results)
+{
+    bool is_finished = false;
+    checker.check(addresses, context, [results] (const LinkCheckResult &result) {
+        results->insert(result.address, result);
+    }, [&is_finished] {
+        is_finished = true;
+    });
+
+    QTRY_VERIFY_WITH_TIMEOUT(is_finished, 10000);
+}
+
+void TestLinkChecker::initTestCase()
+{
+    QVERIFY(m_server.start());
+    m_server.set_responder([this] (const QByteArray &method, const QUrl &url) {
+        StubResponse response;
+        const QString path = url.path();
+        if (path == QStringLiteral("/missing")) {
+            response.status = 404;
+        } else if (path == QStringLiteral("/moved")) {
+            response.status = 301;
+            response.location = m_server.url(QStringLiteral("/ok")).toUtf8();
+        } else if (path == QStringLiteral("/moved-twice")) {
+            response.status = 308;
+            response.location = "/moved";
+        } else if (path == QStringLiteral("/found")) {
+            response.status = 302;
+            response.location = m_server.url(QStringLiteral("/ok")).toUtf8();
+        } else if (path == QStringLiteral("/no-head") && method == "HEAD") {
+            response.status = 405;
+        }
+        return response;
+    });
+}
+
+void TestLinkChecker::init()
+{
+    m_server.set_delay(0);
+}
+
+void TestLinkChecker::test_statuses()
+{
+    LinkChecker checker;
+    QHash<QString, LinkCheckResult> results;
+    check_all(checker, {
+        m_server.url(QStringLiteral("/ok")),
+        m_server.url(QStringLiteral("/missing")),
+        m_server.url(QStringLiteral("/moved")),
+        m_server.url(QStringLiteral("/moved-twice")),
+        m_server.url(QStringLiteral("/found")),
+        QStringLiteral("http://127.0.0.1:1/refused"),
+    }, this, &results);
+
+    QCOMPARE(results.count(), 6);
+    QCOMPARE(results.value(m_server.url(QStringLiteral("/ok"))).status, LinkCheckResult::Ok);
+
+    const LinkCheckResult missing = results.value(m_server.url(QStringLiteral("/missing")));
+    QCOMPARE(missing.status, LinkCheckResult::Broken);
+    QCOMPARE(missing.http_status, 404);
+
+    const LinkCheckResult moved = results.value(m_server.url(QStringLiteral("/moved")));
+    QCOMPARE(moved.status, LinkCheckResult::Moved);
+    QCOMPARE(moved.location, m_server.url(QStringLiteral("/ok")));
+
+    const LinkCheckResult moved_twice = results.value(m_server.url(QStringLiteral("/moved-twice")));
+    QCOMPARE(moved_twice.status, LinkCheckResult::Moved);
+    QCOMPARE(moved_twice.location, m_server.url(QStringLiteral("/ok")));
+
+    const LinkCheckResult found = results.value(m_server.url(QStringLiteral("/found")));
+    QCOMPARE(found.status, LinkCheckResult::Redirected);
+    QCOMPARE(found.location, m_server.url(QStringLiteral("/ok")));
+
+    QCOMPARE(results.value(QStringLiteral("http://127.0.0.1:1/refused")).status, LinkCheckResult::Failed);
+}
+
+void TestLinkChecker::test_head_fallback()
+{
+    const int requests = m_server.methods().count();
+
+    LinkChecker checker;
+    QHash<QString, LinkCheckResult> results;
+    check_all(checker, { m_server.url(QStringLiteral("/no-head")) }, this, &results);
+    QCOMPARE(results.value(m_server.url(QStringLiteral("/no-head"))).status, LinkCheckResult::Ok);
+
+    const QList<QByteArray> methods = m_server.methods().mid(requests);
+    QCOMPARE(methods, QList<QByteArray>({ "HEAD", "GET" }));
+}
+
+void TestLinkChecker::test_concurrency_limits()
+{
+    m_server.set_delay(100);
+    m_server.reset_peak_active();
+
+    QStringList addresses;
+    for (int i = 0; i < 12; i++) {
+        addresses.append(m_server.url(QStringLiteral("/ok?page=%1").arg(i)));
+    }
+
+    LinkChecker checker;
+    checker.set_limits(8, 2);
+    QHash<QString, LinkCheckResult> results;
+    check_all(checker, addresses, this, &results);
+
+    QCOMPARE(results.count(), addresses.count());
+    QVERIFY(m_server.peak_active() <= 2);
+    QCOMPARE(m_server.peak_active(), 2);
+
+    m_server.reset_peak_active();
+    checker.set_limits(1, 4);
+    results.clear();
+    check_all(checker, addresses, this, &results);
+    QCOMPARE(results.count(), addresses.count());
+    QCOMPARE(m_server.peak_active(), 1);
+}
+
+QTEST_MAIN(TestLinkChecker)
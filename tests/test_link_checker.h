@@ -0,0 +1,18 @@
+#pragma once
+
+#include "stub_http_server.h"
+
+#include <QtTest>
+
+class TestLinkChecker : public QObject
+{
+    Q_OBJECT
+
+    StubHttpServer m_server;
+private slots:
+    void initTestCase();
+    void init();
+    void test_statuses();
+    void test_head_fallback();
+    void test_concurrency_limits();
+};
@@ -0,0 +1,69 @@
+#include "test_new_tab.h"
+
+#include <QQuickWidget>
+#include <QQuickWindow>
+#include <QWebEngineView>
+
+const QString PAGE = QStringLiteral("<html><body><h1>New Tab</h1></body></html>");
+const QSize VIEW_SIZE(800, 600);
+const int FRAME_TIMEOUT = 10000;
+
+// the view draws through a QQuickWidget, its first render is the first frame the user sees
+static bool wait_for_frame(QWebEngineView *view)
+{
+    QQuickWidget *widget = nullptr;
+    const bool has_widget = QTest::qWaitFor([view, &widget] {
+        widget = qobject_cast<QQuickWidget *>(view->focusProxy());
+        return widget;
+    }, FRAME_TIMEOUT);
+    if (!has_widget)
+        return false;
+
+    bool is_rendered = false;
+    QMetaObject::Connection connection = QObject::connect(widget->quickWindow(), &QQuickWindow::afterRendering, widget, [&is_rendered] {
+        is_rendered = true;
+    }, Qt::DirectConnection);
+
+    const bool ok = QTest::qWaitFor([&is_rendered] { return is_rendered; }, FRAME_TIMEOUT);
+    QObject::disconnect(connection);
+    return ok;
+}
+
+void TestNewTab::initTestCase()
+{
+    // also starts the profile and the first renderer, so neither benchmark pays for them
+    QWebEngineView view;
+    view.resize(VIEW_SIZE);
+    view.show();
+    view.setHtml(PAGE);
+    if (!wait_for_frame(&view))
+        QSKIP("no frames are rendered on this platform");
+}
+
+void TestNewTab::benchmark_fresh_view()
+{
+    QBENCHMARK_ONCE {
+        QWebEngineView view;
+        view.resize(VIEW_SIZE);
+        view.show();
+        view.setHtml(PAGE);
+        QVERIFY(wait_for_frame(&view));
+    }
+}
+
+void TestNewTab::benchmark_spare_view()
+{
+    // loaded while hidden, the way TabPool keeps its spare
+    QWebEngineView view;
+    view.resize(VIEW_SIZE);
+    QSignalSpy loaded(&view, &QWebEngineView::loadFinished);
+    view.setHtml(PAGE);
+    QVERIFY(loaded.wait(FRAME_TIMEOUT));
+
+    QBENCHMARK_ONCE {
+        view.show();
+        QVERIFY(wait_for_frame(&view));
+    }
+}
+
+QTEST_MAIN(TestNewTab)
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QtTest>
+
+class TestNewTab : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void benchmark_fresh_view();
+    void benchmark_spare_view();
+};
@@ -0,0 +1,104 @@
+#include "test_session.h"
+#include "session.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QWidget>
+
+// stands in for BrowserWindow, which tells the session manager about its close the same way
+class SessionTestWindow : public QWidget
+{
+    SessionManager *m_session_manager = nullptr;
+protected:
+    void closeEvent(QCloseEvent *event) override
+    {
+        m_session_manager->close_window();
+        QWidget::closeEvent(event);
+    }
+public:
+    explicit SessionTestWindow(SessionManager *session_manager, const QString &name)
+        : m_session_manager(session_manager)
+    {
+        setObjectName(name);
+        m_session_manager->add_window(this);
+    }
+};
+
+static void use_test_serializer(SessionManager *session_manager)
+{
+    session_manager->set_serializer([] (QWidget *window) {
+        SessionWindow session_window;
+        session_window.geometry = window->objectName().toUtf8();
+        session_window.tabs.append(window->objectName().toUtf8());
+        return session_window;
+    });
+}
+
+static QVector<SessionWindow> read_session(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+        return QVector<SessionWindow>();
+
+    bool ok = false;
+    const QVector<SessionWindow> windows = SessionManager::decode(file.readAll(), &ok);
+    return ok ? windows : QVector<SessionWindow>();
+}
+
+void TestSession::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    QApplication::setQuitOnLastWindowClosed(false);
+}
+
+void TestSession::test_close_all_windows()
+{
+    SessionManager session_manager(m_dir.filePath(QStringLiteral("all")));
+    use_test_serializer(&session_manager);
+
+    SessionTestWindow first(&session_manager, QStringLiteral("first"));
+    SessionTestWindow second(&session_manager, QStringLiteral("second"));
+    first.show();
+    second.show();
+
+    QApplication::closeAllWindows();
+    QCoreApplication::processEvents();
+    session_manager.wait();
+
+    const QVector<SessionWindow> windows = read_session(session_manager.path());
+    QCOMPARE(windows.count(), 2);
+    QCOMPARE(windows.at(0).geometry, QByteArray("first"));
+    QCOMPARE(windows.at(1).geometry, QByteArray("second"));
+    QCOMPARE(windows.at(1).tabs, QVector<QByteArray> { QByteArray("second") });
+}
+
+void TestSession::test_close_one_window()
+{
+    SessionManager session_manager(m_dir.filePath(QStringLiteral("one")));
+    use_test_serializer(&session_manager);
+
+    SessionTestWindow first(&session_manager, QStringLiteral("first"));
+    SessionTestWindow second(&session_manager, QStringLiteral("second"));
+    first.show();
+    second.show();
+
+    // a window closed while another stays open leaves the session
+    first.close();
+    QCoreApplication::processEvents();
+    session_manager.save();
+    session_manager.wait();
+
+    QVector<SessionWindow> windows = read_session(session_manager.path());
+    QCOMPARE(windows.count(), 1);
+    QCOMPARE(windows.at(0).geometry, QByteArray("second"));
+
+    second.close();
+    QCoreApplication::processEvents();
+    session_manager.wait();
+
+    windows = read_session(session_manager.path());
+    QCOMPARE(windows.count(), 1);
+    QCOMPARE(windows.at(0).geometry, QByteArray("second"));
+}
+
+QTEST_MAIN(TestSession)
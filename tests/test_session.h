@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+class TestSession : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void test_close_all_windows();
+    void test_close_one_window();
+
+private:
+    QTemporaryDir m_dir;
+};
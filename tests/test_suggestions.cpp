@@ -0,0 +1,92 @@
+#include "test_suggestions.h"
+#include "suggestions.h"
+
+#include <QUrlQuery>
+
+void TestSuggestions::initTestCase()
+{
+    QVERIFY(m_server.start());
+    m_server.set_handler([] (const QUrl &url) {
+        const QString query = QUrlQuery(url).queryItemValue(QStringLiteral("q"), QUrl::FullyDecoded);
+        return QStringLiteral("[\"%1\", [\"%1 one\", \"%1 two\"]]").arg(query).toUtf8();
+    });
+}
+
+void TestSuggestions::init()
+{
+    m_server.set_delay(0);
+}
+
+void TestSuggestions::test_parse()
+{
+    QCOMPARE(SuggestionFetcher::parse("[\"qt\", [\"qt creator\", \"qt designer\"]]"),
+             QStringList({ QStringLiteral("qt creator"), QStringLiteral("qt designer") }));
+    QCOMPARE(SuggestionFetcher::parse("{\"query\": \"qt\", \"suggestions\": [\"qt creator\"]}"),
+             QStringList({ QStringLiteral("qt creator") }));
+    QCOMPARE(SuggestionFetcher::parse("[{\"phrase\": \"qt creator\"}, {\"phrase\": \"qt designer\"}]"),
+             QStringList({ QStringLiteral("qt creator"), QStringLiteral("qt designer") }));
+    QCOMPARE(SuggestionFetcher::parse("<?xml version=\"1.0\"?><toplevel><CompleteSuggestion><suggestion data=\"qt creator\"/></CompleteSuggestion>"
+                                      "<CompleteSuggestion><suggestion data=\"qt &amp; c++\"/></CompleteSuggestion></toplevel>"),
+             QStringList({ QStringLiteral("qt creator"), QStringLiteral("qt & c++") }));
+    QVERIFY(SuggestionFetcher::parse("not a response").isEmpty());
+}
+
+void TestSuggestions::test_debounce()
+{
+    const int requests = m_server.requests().count();
+    const QString suggestion_url = m_server.url(QStringLiteral("/debounce?q={searchTerms}"));
+
+    SuggestionFetcher fetcher;
+    QStringList results;
+    auto callback = [&results] (const QStringList &suggestions) { results = suggestions; };
+    fetcher.fetch(suggestion_url, QStringLiteral("d"), this, callback);
+    fetcher.fetch(suggestion_url, QStringLiteral("de"), this, callback);
+    fetcher.fetch(suggestion_url, QStringLiteral("deb ounce"), this, callback);
+
+    QTRY_COMPARE(results, QStringList({ QStringLiteral("deb ounce one"), QStringLiteral("deb ounce two") }));
+    QCOMPARE(m_server.requests().count(), requests + 1);
+}
+
+void TestSuggestions::test_abort()
+{
+    const int requests = m_server.requests().count();
+    const QString suggestion_url = m_server.url(QStringLiteral("/abort?q={searchTerms}"));
+    m_server.set_delay(500);
+
+    SuggestionFetcher fetcher;
+    QStringList results;
+    int calls = 0;
+    auto callback = [&results, &calls] (const QStringList &suggestions) {
+        results = suggestions;
+        calls++;
+    };
+
+    fetcher.fetch(suggestion_url, QStringLiteral("slow"), this, callback);
+    QTRY_COMPARE(m_server.requests().count(), requests + 1);
+
+    fetcher.fetch(suggestion_url, QStringLiteral("slower"), this, callback);
+    QTRY_COMPARE(calls, 1);
+    QCOMPARE(results.first(), QStringLiteral("slower one"));
+
+    QTest::qWait(1000);
+    QCOMPARE(calls, 1);
+}
+
+void TestSuggestions::test_cache()
+{
+    const int requests = m_server.requests().count();
+    const QString suggestion_url = m_server.url(QStringLiteral("/cache?q={searchTerms}"));
+
+    SuggestionFetcher fetcher;
+    int calls = 0;
+    auto callback = [&calls] (const QStringList &) { calls++; };
+
+    fetcher.fetch(suggestion_url, QStringLiteral("cached"), this, callback);
+    QTRY_COMPARE(calls, 1);
+
+    fetcher.fetch(suggestion_url, QStringLiteral("cached"), this, callback);
+    QCOMPARE(calls, 2);
+    QCOMPARE(m_server.requests().count(), requests + 1);
+}
+
+QTEST_MAIN(TestSuggestions)
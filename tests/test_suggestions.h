@@ -0,0 +1,19 @@
+#pragma once
+
+#include "stub_http_server.h"
+
+#include <QtTest>
+
+class TestSuggestions : public QObject
+{
+    Q_OBJECT
+
+    StubHttpServer m_server;
+private slots:
+    void initTestCase();
+    void init();
+    void test_parse();
+    void test_debounce();
+    void test_abort();
+    void test_cache();
+};
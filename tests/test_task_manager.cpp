@@ -0,0 +1,59 @@
+#include "test_task_manager.h"
+#include "task_manager.h"
+
+#include <QCoreApplication>
+
+const int BENCHMARK_SAMPLES = 1000;
+const qint64 MAX_SAMPLE_NSECS = 1000000;
+
+void TestTaskManager::initTestCase()
+{
+    if (!QFile::exists(QStringLiteral("/proc/self/stat")))
+        QSKIP("no /proc filesystem");
+}
+
+void TestTaskManager::test_own_process()
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    ProcessSampler sampler;
+
+    QVector<ProcessSample> samples = sampler.sample({ pid });
+    QCOMPARE(samples.count(), 1);
+    QCOMPARE(samples.first().pid, pid);
+    QVERIFY(samples.first().resident_bytes > 0);
+    QCOMPARE(samples.first().cpu_percent, 0.0);
+
+    // keep a core busy long enough for the tick counters to move
+    QElapsedTimer timer;
+    timer.start();
+    volatile quint64 sum = 0;
+    while (timer.elapsed() < 200) {
+        sum += timer.nsecsElapsed();
+    }
+
+    samples = sampler.sample({ pid });
+    QCOMPARE(samples.count(), 1);
+    QVERIFY(samples.first().cpu_percent > 0);
+}
+
+void TestTaskManager::test_missing_process()
+{
+    ProcessSampler sampler;
+    QVERIFY(sampler.sample({ -1 }).isEmpty());
+}
+
+void TestTaskManager::benchmark_sampling()
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    ProcessSampler sampler;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < BENCHMARK_SAMPLES; i++) {
+        sampler.sample({ pid });
+    }
+    const qint64 elapsed = timer.nsecsElapsed() / BENCHMARK_SAMPLES;
+    QVERIFY2(elapsed < MAX_SAMPLE_NSECS, qPrintable(QStringLiteral("one sample took %1 ns").arg(elapsed)));
+}
+
+QTEST_MAIN(TestTaskManager)
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QtTest>
+
+class TestTaskManager : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void test_own_process();
+    void test_missing_process();
+    void benchmark_sampling();
+};